@@ -0,0 +1,353 @@
+// main.cpp
+//
+// Sergei <Neill3d> Solokhin (https://github.com/Neill3d/OpenFBX)
+//
+// headless benchmark of the loader and the evaluation, run it from the runtime folder
+//  benchmark [-n iterations] [-t threads] [-s scale] [-stats] [-nosamples] [-nosynthetic] [files...]
+
+#include "ofbx.h"
+#include "scene_writer.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace ofbx;
+
+///////////////////////////////////////////////////////////////////////////////////
+// settings
+
+struct BenchSettings
+{
+	int		iterations = 10;
+	int		thread_count = 1;
+	int		scale = 1;
+	bool	print_stats = false;
+	bool	samples = true;
+	bool	synthetic = true;
+
+	std::vector<std::string>	files;
+};
+
+struct BenchScene
+{
+	std::string		name;
+	std::vector<u8>	data;
+};
+
+static double getTime()
+{
+	typedef std::chrono::steady_clock clock;
+	return std::chrono::duration<double, std::milli>(clock::now().time_since_epoch()).count();
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// timing
+
+// wall clock milliseconds of every iteration
+struct Samples
+{
+	std::vector<double>	times;
+
+	double Best() const {
+		return times.empty() ? 0.0 : *std::min_element(times.begin(), times.end());
+	}
+	double Median() const
+	{
+		if (times.empty())
+			return 0.0;
+		std::vector<double> sorted(times);
+		std::sort(sorted.begin(), sorted.end());
+		return sorted[sorted.size() / 2];
+	}
+};
+
+static void printSamples(const char *label, const Samples &samples, const char *rate_unit = nullptr, double work = 0.0)
+{
+	printf("  %-26s best %9.3f ms  median %9.3f ms", label, samples.Best(), samples.Median());
+	if (rate_unit && samples.Best() > 0.0)
+		printf("  %10.2f %s", work / (samples.Best() * 0.001), rate_unit);
+	printf("\n");
+}
+
+static bool readFile(const char *path, std::vector<u8> &data)
+{
+	FILE *fp = fopen(path, "rb");
+	if (nullptr == fp)
+		return false;
+
+	fseek(fp, 0, SEEK_END);
+	const long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	data.resize(size > 0 ? (size_t)size : 0);
+	const bool result = size > 0 && 1 == fread(data.data(), (size_t)size, 1, fp);
+	fclose(fp);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// scene benchmarks
+
+static void printStats(const LoadStats &stats)
+{
+	static const char *phase_names[LoadStats::ePhaseCount] = {
+		"cache", "tokenize", "connections", "takes", "inflate",
+		"objects", "links", "retrieve", "postprocess", "global settings"
+	};
+
+	printf("  load stats: %u elements, %u properties, %u arrays inflated (%.2f MB), arena %.2f / %.2f MB, %u parse contexts\n",
+		stats.element_count, stats.property_count, stats.arrays_inflated,
+		stats.bytes_inflated / (1024.0 * 1024.0), stats.arena_used / (1024.0 * 1024.0), stats.arena_reserved / (1024.0 * 1024.0),
+		stats.parse_contexts);
+	for (int i = 0; i < LoadStats::ePhaseCount; ++i)
+		printf("    %-16s %9.3f ms\n", phase_names[i], stats.phase_time[i]);
+}
+
+static void benchScene(const BenchScene &bench, const BenchSettings &settings)
+{
+	printf("%s (%.2f MB)\n", bench.name.c_str(), bench.data.size() / (1024.0 * 1024.0));
+
+	LoadStats stats;
+	LoadOptions options;
+	options.thread_count = settings.thread_count;
+	options.stats = settings.print_stats ? &stats : nullptr;
+
+	Samples load_samples;
+	IScene *scene = nullptr;
+	for (int i = 0; i < settings.iterations; ++i)
+	{
+		if (scene)
+			scene->destroy();
+
+		const double start = getTime();
+		scene = load(bench.data.data(), (int)bench.data.size(), options);
+		load_samples.times.push_back(getTime() - start);
+
+		if (nullptr == scene)
+		{
+			printf("  failed to load: %s\n", getError());
+			return;
+		}
+	}
+
+	printSamples("load", load_samples, "MB/s", bench.data.size() / (1024.0 * 1024.0));
+	if (settings.print_stats)
+		printStats(stats);
+
+	// scene content
+	int vertex_count = 0;
+	for (int i = 0, count = scene->getMeshCount(); i < count; ++i)
+	{
+		const Geometry *geometry = scene->getMesh(i)->getGeometry();
+		if (geometry)
+			vertex_count += geometry->getVertexCount();
+	}
+
+	std::vector<const AnimationCurve*> curves;
+	const Object *const *objects = scene->getAllObjects();
+	for (int i = 0, count = scene->getAllObjectCount(); i < count; ++i)
+	{
+		if (Object::Type::ANIMATION_CURVE == objects[i]->getType())
+			curves.push_back((const AnimationCurve*)objects[i]);
+	}
+
+	ScenePose pose(*scene);
+	printf("  %d objects, %d meshes (%d vertices), %d models, %d curves, %d takes\n",
+		scene->getAllObjectCount(), scene->getMeshCount(), vertex_count, pose.GetModelCount(),
+		(int)curves.size(), scene->getAnimationStackCount());
+
+	// take switch
+	if (scene->getAnimationStackCount() > 0)
+	{
+		Samples take_samples;
+		for (int i = 0; i < settings.iterations; ++i)
+		{
+			const double start = getTime();
+			scene->PrepTakeConnections(0);
+			take_samples.times.push_back(getTime() - start);
+		}
+		printSamples("PrepTakeConnections", take_samples);
+	}
+
+	// key range of the whole scene, one second when nothing is animated
+	i64 time_start = 0;
+	i64 time_stop = secondsToFbxTime(1.0);
+	if (!curves.empty())
+	{
+		time_start = curves[0]->getKeyCount() > 0 ? curves[0]->getKeyTime()[0] : 0;
+		time_stop = time_start;
+		for (const AnimationCurve *curve : curves)
+		{
+			const int count = curve->getKeyCount();
+			if (count > 0)
+			{
+				time_start = std::min(time_start, curve->getKeyTime()[0]);
+				time_stop = std::max(time_stop, curve->getKeyTime()[count - 1]);
+			}
+		}
+	}
+
+	const int frame_count = 100;
+	const i64 frame_step = std::max<i64>(1, (time_stop - time_start) / frame_count);
+
+	// model global matrices at every frame
+	if (pose.GetModelCount() > 0)
+	{
+		Samples matrix_samples;
+		Samples pose_samples;
+		OFBMatrix m;
+		double checksum = 0.0;
+
+		for (int i = 0; i < settings.iterations; ++i)
+		{
+			double start = getTime();
+			for (int f = 0; f < frame_count; ++f)
+			{
+				const OFBTime time(time_start + f * frame_step);
+				for (int j = 0, count = pose.GetModelCount(); j < count; ++j)
+				{
+					pose.GetModel(j)->GetMatrix(m, eModelTransformation, true, &time);
+					checksum += m[12];
+				}
+			}
+			matrix_samples.times.push_back(getTime() - start);
+
+			start = getTime();
+			for (int f = 0; f < frame_count; ++f)
+			{
+				pose.Evaluate(OFBTime(time_start + f * frame_step));
+				checksum += pose.GetGlobalMatrices()[0][12];
+			}
+			pose_samples.times.push_back(getTime() - start);
+		}
+
+		const double evals = (double)frame_count * pose.GetModelCount();
+		printSamples("Model::GetMatrix", matrix_samples, "models/s", evals);
+		printSamples("ScenePose::Evaluate", pose_samples, "models/s", evals);
+		if (checksum == 1.0)
+			printf("  checksum %f\n", checksum);
+	}
+
+	// curve evaluation along the key range
+	if (!curves.empty())
+	{
+		const int eval_count = 1000;
+		const i64 eval_step = std::max<i64>(1, (time_stop - time_start) / eval_count);
+
+		Samples curve_samples;
+		double checksum = 0.0;
+		for (int i = 0; i < settings.iterations; ++i)
+		{
+			const double start = getTime();
+			for (const AnimationCurve *curve : curves)
+			{
+				for (int e = 0; e < eval_count; ++e)
+					checksum += curve->Evaluate(OFBTime(time_start + e * eval_step));
+			}
+			curve_samples.times.push_back(getTime() - start);
+		}
+
+		printSamples("AnimationCurve::Evaluate", curve_samples, "evals/s", (double)eval_count * curves.size());
+		if (checksum == 1.0)
+			printf("  checksum %f\n", checksum);
+	}
+
+	scene->destroy();
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// main
+
+static void addSynthetic(std::vector<BenchScene> &scenes, const char *name, const bench::SyntheticOptions &options)
+{
+	BenchScene scene;
+	scene.name = name;
+	scene.data = bench::WriteSyntheticScene(options);
+	scenes.push_back(std::move(scene));
+}
+
+int main(int argc, char **argv)
+{
+	BenchSettings settings;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		if (0 == strcmp(arg, "-n") && i + 1 < argc)
+			settings.iterations = std::max(1, atoi(argv[++i]));
+		else if (0 == strcmp(arg, "-t") && i + 1 < argc)
+			settings.thread_count = atoi(argv[++i]);
+		else if (0 == strcmp(arg, "-s") && i + 1 < argc)
+			settings.scale = std::max(1, atoi(argv[++i]));
+		else if (0 == strcmp(arg, "-stats"))
+			settings.print_stats = true;
+		else if (0 == strcmp(arg, "-nosamples"))
+			settings.samples = false;
+		else if (0 == strcmp(arg, "-nosynthetic"))
+			settings.synthetic = false;
+		else if ('-' == arg[0])
+		{
+			printf("usage: benchmark [-n iterations] [-t threads] [-s scale] [-stats] [-nosamples] [-nosynthetic] [files...]\n");
+			return 1;
+		}
+		else
+			settings.files.push_back(arg);
+	}
+
+	if (settings.samples && settings.files.empty())
+	{
+		static const char *sample_files[] = { "a.FBX", "b.fbx", "c.FBX", "d.fbx" };
+		for (const char *file : sample_files)
+			settings.files.push_back(file);
+	}
+
+	std::vector<BenchScene> scenes;
+	for (const std::string &file : settings.files)
+	{
+		BenchScene scene;
+		scene.name = file;
+		if (!readFile(file.c_str(), scene.data))
+		{
+			printf("can't read %s\n", file.c_str());
+			continue;
+		}
+		scenes.push_back(std::move(scene));
+	}
+
+	if (settings.synthetic)
+	{
+		bench::SyntheticOptions options;
+
+		// one big mesh, the same content compressed, raw and as text
+		options.grid_size = 256 * settings.scale;
+		addSynthetic(scenes, "synthetic mesh (binary, compressed)", options);
+		options.compress_arrays = false;
+		addSynthetic(scenes, "synthetic mesh (binary)", options);
+		options.binary = false;
+		addSynthetic(scenes, "synthetic mesh (ascii)", options);
+
+		// many animated models
+		options = bench::SyntheticOptions();
+		options.animated_models = 200 * settings.scale;
+		options.key_count = 300;
+		addSynthetic(scenes, "synthetic animation", options);
+
+		// deep hierarchy
+		options = bench::SyntheticOptions();
+		options.chain_depth = 500 * settings.scale;
+		addSynthetic(scenes, "synthetic hierarchy", options);
+	}
+
+	printf("%d iterations, %d threads\n\n", settings.iterations, settings.thread_count);
+	for (const BenchScene &scene : scenes)
+	{
+		benchScene(scene, settings);
+		printf("\n");
+	}
+
+	return 0;
+}
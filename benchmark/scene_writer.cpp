@@ -0,0 +1,640 @@
+// scene_writer.cpp
+//
+// Sergei <Neill3d> Solokhin (https://github.com/Neill3d/OpenFBX)
+//
+
+#include "scene_writer.h"
+#include "miniz.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace bench
+{
+	///////////////////////////////////////////////////////////////////////////////////
+	// FBXWriter
+
+	static const u32 FBX_VERSION = 7400;
+	static const size_t BLOCK_SENTINEL_LENGTH = 13;
+
+	FBXWriter::FBXWriter(bool binary, bool compress_arrays)
+		: mBinary(binary)
+		, mCompress(compress_arrays)
+	{
+		if (mBinary)
+		{
+			static const char magic[] = "Kaydara FBX Binary  ";
+			PutBytes(magic, sizeof(magic));
+			Put<u8>(0x1A);
+			Put<u8>(0x00);
+			Put<u32>(FBX_VERSION);
+		}
+		else
+		{
+			Text("; FBX 7.4.0 project file\n");
+		}
+	}
+
+	template <typename T> void FBXWriter::Put(const T &value)
+	{
+		PutBytes(&value, sizeof(T));
+	}
+
+	void FBXWriter::PutBytes(const void *data, size_t size)
+	{
+		const u8 *bytes = (const u8*)data;
+		mData.insert(mData.end(), bytes, bytes + size);
+	}
+
+	void FBXWriter::Text(const char *str)
+	{
+		PutBytes(str, strlen(str));
+	}
+
+	void FBXWriter::Indent()
+	{
+		for (size_t i = 0; i < mStack.size(); ++i)
+			Text("\t");
+	}
+
+	void FBXWriter::BeginElement(const char *id)
+	{
+		if (!mStack.empty())
+		{
+			Record &parent = mStack.back();
+			if (!parent.children)
+			{
+				CloseProperties();
+				if (!mBinary)
+					Text(parent.prop_count > 0 ? " {\n" : "{\n");
+				parent.children = true;
+			}
+		}
+
+		Record record;
+		record.start = mData.size();
+		record.prop_count = 0;
+		record.children = false;
+
+		if (mBinary)
+		{
+			const u8 length = (u8)strlen(id);
+			Put<u32>(0);	// end offset
+			Put<u32>(0);	// property count
+			Put<u32>(0);	// property list length
+			Put<u8>(length);
+			PutBytes(id, length);
+		}
+		else
+		{
+			Indent();
+			Text(id);
+			Text(": ");
+		}
+
+		record.props = mData.size();
+		mStack.push_back(record);
+	}
+
+	// binary: patch the property count and length once the properties are written
+	void FBXWriter::CloseProperties()
+	{
+		if (!mBinary)
+			return;
+
+		Record &record = mStack.back();
+		const u32 length = (u32)(mData.size() - record.props);
+		memcpy(&mData[record.start + 4], &record.prop_count, sizeof(u32));
+		memcpy(&mData[record.start + 8], &length, sizeof(u32));
+	}
+
+	void FBXWriter::EndElement()
+	{
+		Record record = mStack.back();
+		if (!record.children)
+			CloseProperties();
+
+		if (mBinary)
+		{
+			// the SDK ends an element with children or without properties by a null record
+			if (record.children || 0 == record.prop_count)
+			{
+				const u8 zero[BLOCK_SENTINEL_LENGTH] = {};
+				PutBytes(zero, sizeof(zero));
+			}
+			const u32 end_offset = (u32)mData.size();
+			memcpy(&mData[record.start], &end_offset, sizeof(u32));
+			mStack.pop_back();
+		}
+		else
+		{
+			mStack.pop_back();
+			if (record.children)
+			{
+				Indent();
+				Text("}\n");
+			}
+			else if (0 == record.prop_count)
+			{
+				Text("{\n");
+				Indent();
+				Text("}\n");
+			}
+			else
+			{
+				Text("\n");
+			}
+		}
+	}
+
+	void FBXWriter::BeginProperty()
+	{
+		Record &record = mStack.back();
+		if (!mBinary && record.prop_count > 0)
+			Text(", ");
+		++record.prop_count;
+	}
+
+	void FBXWriter::AddInt(int value)
+	{
+		BeginProperty();
+		if (mBinary)
+		{
+			Put<u8>('I');
+			Put<int>(value);
+		}
+		else
+		{
+			char tmp[32];
+			snprintf(tmp, sizeof(tmp), "%d", value);
+			Text(tmp);
+		}
+	}
+
+	void FBXWriter::AddLong(i64 value)
+	{
+		BeginProperty();
+		if (mBinary)
+		{
+			Put<u8>('L');
+			Put<i64>(value);
+		}
+		else
+		{
+			char tmp[32];
+			snprintf(tmp, sizeof(tmp), "%lld", (long long)value);
+			Text(tmp);
+		}
+	}
+
+	// the ASCII tokenizer tells doubles from integers by the decimal point
+	static void formatDouble(char (&tmp)[64], double value)
+	{
+		snprintf(tmp, sizeof(tmp), "%.17g", value);
+		if (strchr(tmp, '.') || strchr(tmp, 'n') || strchr(tmp, 'i'))
+			return;
+
+		char *exponent = strchr(tmp, 'e');
+		const size_t length = strlen(tmp);
+		if (length + 3 > sizeof(tmp))
+			return;
+		if (exponent)
+		{
+			memmove(exponent + 2, exponent, strlen(exponent) + 1);
+			exponent[0] = '.';
+			exponent[1] = '0';
+		}
+		else
+		{
+			strcat(tmp, ".0");
+		}
+	}
+
+	void FBXWriter::AddDouble(double value)
+	{
+		BeginProperty();
+		if (mBinary)
+		{
+			Put<u8>('D');
+			Put<double>(value);
+		}
+		else
+		{
+			char tmp[64];
+			formatDouble(tmp, value);
+			Text(tmp);
+		}
+	}
+
+	void FBXWriter::AddString(const char *value)
+	{
+		BeginProperty();
+		const u32 length = (u32)strlen(value);
+		if (mBinary)
+		{
+			Put<u8>('S');
+			Put<u32>(length);
+			PutBytes(value, length);
+		}
+		else
+		{
+			Text("\"");
+			Text(value);
+			Text("\"");
+		}
+	}
+
+	void FBXWriter::AddName(const char *name, const char *object_class)
+	{
+		if (mBinary)
+		{
+			std::string value(name);
+			value += '\0';
+			value += '\1';
+			value += object_class;
+
+			BeginProperty();
+			Put<u8>('S');
+			Put<u32>((u32)value.size());
+			PutBytes(value.data(), value.size());
+		}
+		else
+		{
+			std::string value(object_class);
+			value += "::";
+			value += name;
+			AddString(value.c_str());
+		}
+	}
+
+	template <typename T> void FBXWriter::AddBinaryArray(char type, const T *values, int count)
+	{
+		BeginProperty();
+		Put<u8>((u8)type);
+		Put<u32>((u32)count);
+
+		const mz_ulong size = (mz_ulong)(count * sizeof(T));
+		if (mCompress && count > 0)
+		{
+			std::vector<u8> compressed(mz_compressBound(size));
+			mz_ulong compressed_size = (mz_ulong)compressed.size();
+			if (MZ_OK == mz_compress(compressed.data(), &compressed_size, (const u8*)values, size))
+			{
+				Put<u32>(1);
+				Put<u32>((u32)compressed_size);
+				PutBytes(compressed.data(), compressed_size);
+				return;
+			}
+		}
+
+		Put<u32>(0);
+		Put<u32>((u32)size);
+		if (count > 0)
+			PutBytes(values, size);
+	}
+
+	template <typename T> void FBXWriter::AddTextArray(const T *values, int count, const char *format)
+	{
+		BeginProperty();
+
+		char tmp[64];
+		snprintf(tmp, sizeof(tmp), "*%d {\n", count);
+		Text(tmp);
+		Indent();
+		Text("\ta: ");
+		for (int i = 0; i < count; ++i)
+		{
+			if (i > 0)
+				Text((i % 16) ? "," : ",\n");
+			if (nullptr == format)
+				formatDouble(tmp, (double)values[i]);
+			else
+				snprintf(tmp, sizeof(tmp), format, values[i]);
+			Text(tmp);
+		}
+		Text("\n");
+		Indent();
+		Text("}");
+	}
+
+	void FBXWriter::AddArray(const double *values, int count)
+	{
+		if (mBinary)
+			AddBinaryArray('d', values, count);
+		else
+			AddTextArray(values, count, nullptr);
+	}
+
+	void FBXWriter::AddArray(const float *values, int count)
+	{
+		if (mBinary)
+			AddBinaryArray('f', values, count);
+		else
+			AddTextArray(values, count, nullptr);
+	}
+
+	void FBXWriter::AddArray(const int *values, int count)
+	{
+		if (mBinary)
+			AddBinaryArray('i', values, count);
+		else
+			AddTextArray(values, count, "%d");
+	}
+
+	void FBXWriter::AddArray(const i64 *values, int count)
+	{
+		if (mBinary)
+		{
+			AddBinaryArray('l', values, count);
+			return;
+		}
+
+		std::vector<long long> tmp(values, values + count);
+		AddTextArray(tmp.data(), count, "%lld");
+	}
+
+	void FBXWriter::AddElement(const char *id, int value)
+	{
+		BeginElement(id);
+		AddInt(value);
+		EndElement();
+	}
+
+	void FBXWriter::AddElement(const char *id, const char *value)
+	{
+		BeginElement(id);
+		AddString(value);
+		EndElement();
+	}
+
+	void FBXWriter::AddP(const char *name, const char *type, const char *label, const char *flags, const double *values, int count)
+	{
+		BeginElement("P");
+		AddString(name);
+		AddString(type);
+		AddString(label);
+		AddString(flags);
+		for (int i = 0; i < count; ++i)
+			AddDouble(values[i]);
+		EndElement();
+	}
+
+	void FBXWriter::AddP(const char *name, const char *type, const char *label, const char *flags, int value)
+	{
+		BeginElement("P");
+		AddString(name);
+		AddString(type);
+		AddString(label);
+		AddString(flags);
+		AddInt(value);
+		EndElement();
+	}
+
+	std::vector<u8> FBXWriter::Finish()
+	{
+		while (!mStack.empty())
+			EndElement();
+
+		if (mBinary)
+		{
+			// top level null record
+			const u8 zero[BLOCK_SENTINEL_LENGTH] = {};
+			PutBytes(zero, sizeof(zero));
+		}
+
+		std::vector<u8> result;
+		result.swap(mData);
+		return result;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// synthetic scenes
+
+	struct Connection
+	{
+		i64			from;
+		i64			to;
+		const char	*property;
+	};
+
+	static void writeGrid(FBXWriter &writer, int size, i64 geometry_id)
+	{
+		const int points = size + 1;
+
+		std::vector<double> vertices;
+		std::vector<double> uvs;
+		vertices.reserve(points * points * 3);
+		uvs.reserve(points * points * 2);
+		for (int z = 0; z < points; ++z)
+		{
+			for (int x = 0; x < points; ++x)
+			{
+				vertices.push_back((double)x);
+				vertices.push_back(sin(x * 0.1) * cos(z * 0.1));
+				vertices.push_back((double)z);
+				uvs.push_back((double)x / size);
+				uvs.push_back((double)z / size);
+			}
+		}
+
+		std::vector<int> indices;
+		std::vector<int> uv_indices;
+		std::vector<double> normals;
+		indices.reserve(size * size * 4);
+		uv_indices.reserve(size * size * 4);
+		normals.reserve(size * size * 12);
+		for (int z = 0; z < size; ++z)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				const int quad[4] = { z * points + x, (z + 1) * points + x, (z + 1) * points + x + 1, z * points + x + 1 };
+				for (int i = 0; i < 4; ++i)
+				{
+					// the last index of a polygon is stored as -index - 1
+					indices.push_back(i == 3 ? -quad[i] - 1 : quad[i]);
+					uv_indices.push_back(quad[i]);
+					normals.push_back(0.0);
+					normals.push_back(1.0);
+					normals.push_back(0.0);
+				}
+			}
+		}
+
+		writer.BeginElement("Geometry");
+		writer.AddLong(geometry_id);
+		writer.AddName("grid", "Geometry");
+		writer.AddString("Mesh");
+		{
+			writer.AddArrayElement("Vertices", vertices);
+			writer.AddArrayElement("PolygonVertexIndex", indices);
+			writer.AddElement("GeometryVersion", 124);
+
+			writer.BeginElement("LayerElementNormal");
+			writer.AddInt(0);
+			writer.AddElement("Version", 101);
+			writer.AddElement("Name", "");
+			writer.AddElement("MappingInformationType", "ByPolygonVertex");
+			writer.AddElement("ReferenceInformationType", "Direct");
+			writer.AddArrayElement("Normals", normals);
+			writer.EndElement();
+
+			writer.BeginElement("LayerElementUV");
+			writer.AddInt(0);
+			writer.AddElement("Version", 101);
+			writer.AddElement("Name", "map1");
+			writer.AddElement("MappingInformationType", "ByPolygonVertex");
+			writer.AddElement("ReferenceInformationType", "IndexToDirect");
+			writer.AddArrayElement("UV", uvs);
+			writer.AddArrayElement("UVIndex", uv_indices);
+			writer.EndElement();
+		}
+		writer.EndElement();
+	}
+
+	static void writeModel(FBXWriter &writer, i64 id, const char *name, const char *model_class, const double (&translation)[3])
+	{
+		writer.BeginElement("Model");
+		writer.AddLong(id);
+		writer.AddName(name, "Model");
+		writer.AddString(model_class);
+		{
+			writer.AddElement("Version", 232);
+			writer.BeginElement("Properties70");
+			writer.AddP("Lcl Translation", "Lcl Translation", "", "A", translation, 3);
+			writer.EndElement();
+		}
+		writer.EndElement();
+	}
+
+	std::vector<u8> WriteSyntheticScene(const SyntheticOptions &options)
+	{
+		FBXWriter writer(options.binary, options.compress_arrays);
+		std::vector<Connection> connections;
+		i64 next_id = 1000;
+
+		writer.BeginElement("FBXHeaderExtension");
+		writer.AddElement("FBXHeaderVersion", 1003);
+		writer.AddElement("FBXVersion", (int)FBX_VERSION);
+		writer.EndElement();
+
+		writer.BeginElement("Objects");
+
+		if (options.grid_size > 0)
+		{
+			const i64 model_id = next_id++;
+			const i64 geometry_id = next_id++;
+			writeGrid(writer, options.grid_size, geometry_id);
+
+			const double origin[3] = { 0.0, 0.0, 0.0 };
+			writeModel(writer, model_id, "grid", "Mesh", origin);
+			connections.push_back({ model_id, 0, nullptr });
+			connections.push_back({ geometry_id, model_id, nullptr });
+		}
+
+		if (options.animated_models > 0 && options.key_count > 1)
+		{
+			const i64 stack_id = next_id++;
+			const i64 layer_id = next_id++;
+
+			writer.BeginElement("AnimationStack");
+			writer.AddLong(stack_id);
+			writer.AddName("Take 001", "AnimStack");
+			writer.AddString("");
+			writer.EndElement();
+
+			writer.BeginElement("AnimationLayer");
+			writer.AddLong(layer_id);
+			writer.AddName("BaseLayer", "AnimLayer");
+			writer.AddString("");
+			writer.EndElement();
+			connections.push_back({ layer_id, stack_id, nullptr });
+
+			std::vector<i64> times(options.key_count);
+			std::vector<float> values(options.key_count);
+			for (int i = 0; i < options.key_count; ++i)
+				times[i] = ofbx::secondsToFbxTime(i / 30.0);
+
+			static const char *curve_properties[3] = { "d|X", "d|Y", "d|Z" };
+			static const char *node_properties[2] = { "Lcl Translation", "Lcl Rotation" };
+			static const char *node_names[2] = { "T", "R" };
+
+			for (int m = 0; m < options.animated_models; ++m)
+			{
+				char name[64];
+				snprintf(name, sizeof(name), "animated%d", m);
+
+				const i64 model_id = next_id++;
+				const double position[3] = { (double)m, 0.0, 0.0 };
+				writeModel(writer, model_id, name, "Null", position);
+				connections.push_back({ model_id, 0, nullptr });
+
+				for (int n = 0; n < 2; ++n)
+				{
+					const i64 node_id = next_id++;
+					writer.BeginElement("AnimationCurveNode");
+					writer.AddLong(node_id);
+					writer.AddName(node_names[n], "AnimCurveNode");
+					writer.AddString("");
+					writer.BeginElement("Properties70");
+					for (int c = 0; c < 3; ++c)
+					{
+						const double zero = 0.0;
+						writer.AddP(curve_properties[c], "Number", "", "A", &zero, 1);
+					}
+					writer.EndElement();
+					writer.EndElement();
+
+					connections.push_back({ node_id, layer_id, nullptr });
+					connections.push_back({ node_id, model_id, node_properties[n] });
+
+					for (int c = 0; c < 3; ++c)
+					{
+						const i64 curve_id = next_id++;
+						for (int i = 0; i < options.key_count; ++i)
+							values[i] = (float)sin((i + m) * 0.05 + c + n * 3);
+
+						writer.BeginElement("AnimationCurve");
+						writer.AddLong(curve_id);
+						writer.AddName("", "AnimCurve");
+						writer.AddString("");
+						writer.AddElement("KeyVer", 4008);
+						writer.AddArrayElement("KeyTime", times);
+						writer.AddArrayElement("KeyValueFloat", values);
+						writer.EndElement();
+
+						connections.push_back({ curve_id, node_id, curve_properties[c] });
+					}
+				}
+			}
+		}
+
+		for (int i = 0; i < options.chain_depth; ++i)
+		{
+			char name[64];
+			snprintf(name, sizeof(name), "chain%d", i);
+
+			const i64 model_id = next_id++;
+			const double offset[3] = { 0.0, 1.0, 0.0 };
+			writeModel(writer, model_id, name, "Null", offset);
+			connections.push_back({ model_id, i == 0 ? 0 : model_id - 1, nullptr });
+		}
+
+		writer.EndElement();
+
+		writer.BeginElement("Connections");
+		for (const Connection &connection : connections)
+		{
+			writer.BeginElement("C");
+			writer.AddString(connection.property ? "OP" : "OO");
+			writer.AddLong(connection.from);
+			writer.AddLong(connection.to);
+			if (connection.property)
+				writer.AddString(connection.property);
+			writer.EndElement();
+		}
+		writer.EndElement();
+
+		return writer.Finish();
+	}
+
+};
@@ -0,0 +1,107 @@
+#ifndef _SCENE_WRITER_H_
+#define _SCENE_WRITER_H_
+
+// scene_writer.h
+//
+// Sergei <Neill3d> Solokhin (https://github.com/Neill3d/OpenFBX)
+//
+
+#include "ofbx.h"
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	using ofbx::u8;
+	using ofbx::u32;
+	using ofbx::u64;
+	using ofbx::i64;
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// FBXWriter
+
+	// in-memory writer of the FBX 7.4 node tree, binary (raw or zlib compressed arrays) or ASCII
+	//  elements are nested with BeginElement / EndElement, all the properties of an element come before its children
+	class FBXWriter
+	{
+	public:
+
+		FBXWriter(bool binary, bool compress_arrays);
+
+		void BeginElement(const char *id);
+		void EndElement();
+
+		void AddInt(int value);
+		void AddLong(i64 value);
+		void AddDouble(double value);
+		void AddString(const char *value);
+		// object name, "name\x00\x01class" in binary and "class::name" in ASCII
+		void AddName(const char *name, const char *object_class);
+
+		void AddArray(const double *values, int count);
+		void AddArray(const float *values, int count);
+		void AddArray(const int *values, int count);
+		void AddArray(const i64 *values, int count);
+
+		// shorthands of one element with the given properties
+		void AddElement(const char *id, int value);
+		void AddElement(const char *id, const char *value);
+		template <typename T> void AddArrayElement(const char *id, const std::vector<T> &values)
+		{
+			BeginElement(id);
+			AddArray(values.empty() ? nullptr : values.data(), (int)values.size());
+			EndElement();
+		}
+
+		// Properties70 entry "P: name, type, label, flags, values..."
+		void AddP(const char *name, const char *type, const char *label, const char *flags, const double *values, int count);
+		void AddP(const char *name, const char *type, const char *label, const char *flags, int value);
+
+		// terminate the top level and return the file content
+		std::vector<u8> Finish();
+
+	protected:
+
+		struct Record
+		{
+			size_t		start;		// binary: position of the end offset
+			size_t		props;		// binary: position of the first property
+			u32			prop_count;
+			bool		children;
+		};
+
+		void CloseProperties();
+		void BeginProperty();
+		template <typename T> void Put(const T &value);
+		void PutBytes(const void *data, size_t size);
+		void Text(const char *str);
+		void Indent();
+		template <typename T> void AddBinaryArray(char type, const T *values, int count);
+		template <typename T> void AddTextArray(const T *values, int count, const char *format);
+
+		bool					mBinary;
+		bool					mCompress;
+		std::vector<u8>			mData;
+		std::vector<Record>		mStack;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// synthetic scenes
+
+	struct SyntheticOptions
+	{
+		bool	binary = true;
+		bool	compress_arrays = true;
+
+		int		grid_size = 0;			// one mesh of grid_size x grid_size quads with normals and uvs, 0 - none
+		int		animated_models = 0;	// models with animated translation and rotation (6 curves each)
+		int		key_count = 0;			// keys per curve
+		int		chain_depth = 0;		// chain of null models, each one the child of the previous
+	};
+
+	// the whole scene as an FBX file content
+	std::vector<u8> WriteSyntheticScene(const SyntheticOptions &options);
+
+};
+
+#endif
@@ -565,18 +565,9 @@ bool init()
 	ShowWindow(g_hWnd, SW_SHOW);
 	initImGUI();
 
-	FILE* fp = fopen("c.fbx", "rb");
-	if (!fp) return false;
-
-	fseek(fp, 0, SEEK_END);
-	long file_size = ftell(fp);
-	fseek(fp, 0, SEEK_SET);
-	auto* content = new ofbx::u8[file_size];
-	fread(content, 1, file_size, fp);
-	g_scene = ofbx::load((ofbx::u8*)content, file_size);
+	g_scene = ofbx::loadFile("c.fbx");
+	if (!g_scene) return false;
 	saveAsOBJ(*g_scene, "out.obj");
-	delete[] content;
-	fclose(fp);
 
 	return true;
 }
@@ -298,3 +298,67 @@ project "openfbx"
 		flags { "NoExceptions", "NoFramePointer", "NoIncrementalLink", "NoRTTI", "OptimizeSize", "No64BitChecks" }
 		linkoptions { "/NODEFAULTLIB"}
 		linkoptions { "/MANIFEST:NO"}
+
+project "benchmark"
+	kind "ConsoleApp"
+
+	debugdir ("../runtime")
+
+	files { "../src/**.c", "../src/**.cpp", "../src/**.h", "../benchmark/**.cpp", "../benchmark/**.h" }
+
+	defines {"_CRT_SECURE_NO_WARNINGS", "_HAS_ITERATOR_DEBUGGING=0" }
+	-- same as the library in the demo, so the benchmark can't depend on what the demo build lacks
+	flags { "NoExceptions", "NoRTTI" }
+
+	-- defaultConfigurations() sets WinMain, a console app keeps main()
+	configuration "Debug"
+		targetdir(BINARY_DIR .. "Debug")
+		defines { "DEBUG", "_DEBUG" }
+		flags { "Symbols" }
+
+	configuration "Release"
+		targetdir(BINARY_DIR .. "Release")
+		defines { "NDEBUG" }
+		flags { "Optimize" }
+
+	configuration "RelWithDebInfo"
+		targetdir(BINARY_DIR .. "RelWithDebInfo")
+		defines { "NDEBUG" }
+		flags { "Symbols", "Optimize" }
+
+	configuration "linux"
+		buildoptions { "-std=c++14" }
+		links { "pthread" }
+
+	configuration {}
+
+project "test"
+	kind "ConsoleApp"
+
+	files { "../src/**.c", "../src/**.cpp", "../src/**.h", "../test/**.cpp" }
+
+	defines {"_CRT_SECURE_NO_WARNINGS", "_HAS_ITERATOR_DEBUGGING=0" }
+	-- same as the library in the demo, so the tests run the code the demo build ships
+	flags { "NoExceptions", "NoRTTI" }
+
+	-- defaultConfigurations() sets WinMain, a console app keeps main()
+	configuration "Debug"
+		targetdir(BINARY_DIR .. "Debug")
+		defines { "DEBUG", "_DEBUG" }
+		flags { "Symbols" }
+
+	configuration "Release"
+		targetdir(BINARY_DIR .. "Release")
+		defines { "NDEBUG" }
+		flags { "Optimize" }
+
+	configuration "RelWithDebInfo"
+		targetdir(BINARY_DIR .. "RelWithDebInfo")
+		defines { "NDEBUG" }
+		flags { "Symbols", "Optimize" }
+
+	configuration "linux"
+		buildoptions { "-std=c++14" }
+		links { "pthread" }
+
+	configuration {}
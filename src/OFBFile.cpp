@@ -0,0 +1,147 @@
+// OFBFile.cpp
+//
+// Sergei <Neill3d> Solokhin (https://github.com/Neill3d/OpenFBX)
+//
+
+#include "OFBFile.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ofbx
+{
+	///////////////////////////////////////////////////////////////////////////////////
+	// OFBMappedFile
+
+	OFBMappedFile::OFBMappedFile()
+	{
+		mData = nullptr;
+		mSize = 0;
+
+#if defined(_WIN32)
+		mFile = INVALID_HANDLE_VALUE;
+		mMapping = nullptr;
+#else
+		mFile = -1;
+#endif
+	}
+
+	OFBMappedFile::~OFBMappedFile()
+	{
+		Close();
+	}
+
+#if defined(_WIN32)
+
+	bool OFBMappedFile::Open(const char *path)
+	{
+		Close();
+
+		mFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+		if (INVALID_HANDLE_VALUE == mFile)
+			return false;
+
+		LARGE_INTEGER size;
+		if (FALSE == GetFileSizeEx(mFile, &size) || 0 == size.QuadPart)
+		{
+			Close();
+			return false;
+		}
+
+		mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (nullptr == mMapping)
+		{
+			Close();
+			return false;
+		}
+
+		mData = (const u8*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+		if (nullptr == mData)
+		{
+			Close();
+			return false;
+		}
+
+		mSize = (size_t)size.QuadPart;
+		return true;
+	}
+
+	void OFBMappedFile::Close()
+	{
+		if (nullptr != mData)
+		{
+			UnmapViewOfFile(mData);
+			mData = nullptr;
+		}
+		if (nullptr != mMapping)
+		{
+			CloseHandle(mMapping);
+			mMapping = nullptr;
+		}
+		if (INVALID_HANDLE_VALUE != mFile)
+		{
+			CloseHandle(mFile);
+			mFile = INVALID_HANDLE_VALUE;
+		}
+		mSize = 0;
+	}
+
+#else
+
+	bool OFBMappedFile::Open(const char *path)
+	{
+		Close();
+
+		mFile = open(path, O_RDONLY);
+		if (mFile < 0)
+			return false;
+
+		struct stat st;
+		if (0 != fstat(mFile, &st) || 0 == st.st_size)
+		{
+			Close();
+			return false;
+		}
+
+		void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, mFile, 0);
+		if (MAP_FAILED == data)
+		{
+			Close();
+			return false;
+		}
+
+		mData = (const u8*)data;
+		mSize = (size_t)st.st_size;
+		return true;
+	}
+
+	void OFBMappedFile::Close()
+	{
+		if (nullptr != mData)
+		{
+			munmap((void*)mData, mSize);
+			mData = nullptr;
+		}
+		if (mFile >= 0)
+		{
+			close(mFile);
+			mFile = -1;
+		}
+		mSize = 0;
+	}
+
+#endif
+
+};
@@ -0,0 +1,60 @@
+#ifndef _OFBFILE_H_
+#define _OFBFILE_H_
+
+// OFBFile.h
+//
+// Sergei <Neill3d> Solokhin (https://github.com/Neill3d/OpenFBX)
+//
+
+#include "OFBTypes.h"
+
+namespace ofbx
+{
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// OFBMappedFile
+
+	// read-only memory mapping of a whole file (Windows: CreateFileMapping, Linux/Android: mmap)
+	//  pages are brought in by the OS on first access, untouched regions are never read from disk
+	class OFBMappedFile
+	{
+	public:
+
+		//! a constructor
+		OFBMappedFile();
+		~OFBMappedFile();
+
+		bool Open(const char *path);
+		void Close();
+
+		bool IsOpen() const {
+			return nullptr != mData;
+		}
+
+		const u8 *GetData() const {
+			return mData;
+		}
+		size_t GetSize() const {
+			return mSize;
+		}
+
+	protected:
+
+		const u8		*mData;
+		size_t			mSize;
+
+#if defined(_WIN32)
+		void			*mFile;
+		void			*mMapping;
+#else
+		int				mFile;
+#endif
+
+		// non-copyable, the mapping is released in the destructor
+		OFBMappedFile(const OFBMappedFile&) = delete;
+		OFBMappedFile &operator = (const OFBMappedFile&) = delete;
+	};
+
+};
+
+#endif
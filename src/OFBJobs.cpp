@@ -0,0 +1,160 @@
+// OFBJobs.cpp
+//
+// Sergei <Neill3d> Solokhin (https://github.com/Neill3d/OpenFBX)
+//
+
+#include "OFBJobs.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace ofbx
+{
+	///////////////////////////////////////////////////////////////////////////////////
+	// Jobs
+
+	struct JobBatch
+	{
+		JobFunction			fn;
+		u8					*data;
+		u32					size;
+		u32					count;
+		std::atomic<u32>	next;
+		std::atomic<u32>	done;
+	};
+
+	static bool ProcessNext(JobBatch *batch)
+	{
+		const u32 idx = batch->next.fetch_add(1, std::memory_order_relaxed);
+		if (idx >= batch->count)
+			return false;
+
+		batch->fn(batch->data + (size_t)idx * batch->size);
+		batch->done.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	static void ProcessBatch(JobBatch *batch)
+	{
+		while (ProcessNext(batch))
+		{
+		}
+	}
+
+	static int GetWorkerCount(int thread_count, u32 count)
+	{
+		if (thread_count <= 0)
+			thread_count = GetHardwareThreadCount();
+		if ((u32)thread_count > count)
+			thread_count = (int)count;
+		return thread_count;
+	}
+
+	void RunJobs(JobFunction fn, void *data, u32 size, u32 count, int thread_count, JobProcessor processor, void *user_ptr)
+	{
+		if (0 == count)
+			return;
+
+		if (nullptr != processor)
+		{
+			processor(fn, user_ptr, data, size, count);
+			return;
+		}
+
+		thread_count = GetWorkerCount(thread_count, count);
+
+		if (thread_count <= 1)
+		{
+			u8 *ptr = (u8*)data;
+			for (u32 i = 0; i < count; ++i, ptr += size)
+				fn(ptr);
+			return;
+		}
+
+		JobBatch batch;
+		batch.fn = fn;
+		batch.data = (u8*)data;
+		batch.size = size;
+		batch.count = count;
+		batch.next = 0;
+		batch.done = 0;
+
+		std::vector<std::thread> workers;
+		workers.reserve(thread_count - 1);
+		for (int i = 1; i < thread_count; ++i)
+			workers.emplace_back(ProcessBatch, &batch);
+
+		ProcessBatch(&batch);
+
+		for (auto &worker : workers)
+			worker.join();
+	}
+
+	bool RunJobsWithProgress(JobFunction fn, void *data, u32 size, u32 count, int thread_count, JobProgress progress, void *progress_user_ptr,
+		JobProcessor processor, void *user_ptr)
+	{
+		if (0 == count)
+			return true;
+
+		const u32 step = std::max(count / 32, (u32)16);
+
+		// the processor returns only when its items are done, so it's called once per report
+		if (nullptr != processor)
+		{
+			for (u32 begin = 0; begin < count; begin += step)
+			{
+				const u32 chunk = std::min(step, count - begin);
+				processor(fn, user_ptr, (u8*)data + (size_t)begin * size, size, chunk);
+				if (!progress(begin + chunk, count, progress_user_ptr))
+					return false;
+			}
+			return true;
+		}
+
+		thread_count = GetWorkerCount(thread_count, count);
+
+		JobBatch batch;
+		batch.fn = fn;
+		batch.data = (u8*)data;
+		batch.size = size;
+		batch.count = count;
+		batch.next = 0;
+		batch.done = 0;
+
+		std::vector<std::thread> workers;
+		workers.reserve(thread_count - 1);
+		for (int i = 1; i < thread_count; ++i)
+			workers.emplace_back(ProcessBatch, &batch);
+
+		bool is_running = true;
+		u32 reported = 0;
+		while (ProcessNext(&batch))
+		{
+			const u32 done = batch.done.load(std::memory_order_relaxed);
+			if (done - reported < step || done == count)
+				continue;
+
+			reported = done;
+			if (!progress(done, count, progress_user_ptr))
+			{
+				// the workers pull no further items
+				batch.next.store(count, std::memory_order_relaxed);
+				is_running = false;
+				break;
+			}
+		}
+
+		for (auto &worker : workers)
+			worker.join();
+
+		return is_running && progress(count, count, progress_user_ptr);
+	}
+
+	int GetHardwareThreadCount()
+	{
+		const unsigned int count = std::thread::hardware_concurrency();
+		return (count > 0) ? (int)count : 1;
+	}
+
+};
@@ -0,0 +1,44 @@
+#ifndef _OFBJOBS_H_
+#define _OFBJOBS_H_
+
+// OFBJobs.h
+//
+// Sergei <Neill3d> Solokhin (https://github.com/Neill3d/OpenFBX)
+//
+
+#include "OFBTypes.h"
+
+namespace ofbx
+{
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// Jobs
+
+	// one job, data points to the item to process
+	typedef void(*JobFunction)(void *data);
+
+	// progress of RunJobsWithProgress(), called on the calling thread with the number of finished items
+	//  returning false stops handing out the items which haven't started yet
+	typedef bool(*JobProgress)(u32 done, u32 count, void *user_ptr);
+
+	// hook for an external job system
+	//  must call fn(data + i * size) for every i in [0, count) and return only when all of them are done
+	typedef void(*JobProcessor)(JobFunction fn, void *user_ptr, void *data, u32 size, u32 count);
+
+	// process count items of size bytes starting at data
+	//  with a processor the work is handed over to it, otherwise up to thread_count threads
+	//  (the calling one included) pull items from a shared counter
+	void RunJobs(JobFunction fn, void *data, u32 size, u32 count, int thread_count, JobProcessor processor = nullptr, void *user_ptr = nullptr);
+
+	// RunJobs() with about 32 progress reports, the threads stay for the whole run and the calling thread
+	//  reports between its own items, a processor gets the items in chunks with a report after each one
+	//  false when the progress stopped the run, the items already started are finished anyway
+	bool RunJobsWithProgress(JobFunction fn, void *data, u32 size, u32 count, int thread_count, JobProgress progress, void *progress_user_ptr,
+		JobProcessor processor = nullptr, void *user_ptr = nullptr);
+
+	// number of hardware threads, at least 1
+	int GetHardwareThreadCount();
+
+};
+
+#endif
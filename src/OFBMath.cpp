@@ -9,6 +9,21 @@
 #include <assert.h>
 #include <algorithm>
 
+// SIMD kernels are picked at compile time from the target instruction set, define OFBMATH_NO_SIMD to force the scalar code
+//  the kernels keep the operation order of the scalar code and never fuse multiply-add, so results match the scalar path
+#if !defined(OFBMATH_NO_SIMD)
+#if defined(__AVX__)
+#define OFBMATH_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OFBMATH_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define OFBMATH_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
 #define TO_RAD  3.1415926535897932384626433832795028 / 180.0
 
 namespace ofbx
@@ -42,21 +57,93 @@ namespace ofbx
 	}
 
 
-	OFBMatrix operator*(const OFBMatrix& lhs, const OFBMatrix& rhs)
+	// D = L * R for column-major 4x4 double matrices, D may alias L or R
+	static inline void MatrixMultKernel(double *D, const double *L, const double *R)
 	{
-		OFBMatrix res;
-		for (int j = 0; j < 4; ++j)
+#if defined(OFBMATH_AVX)
+		const __m256d l0 = _mm256_loadu_pd(L);
+		const __m256d l1 = _mm256_loadu_pd(L + 4);
+		const __m256d l2 = _mm256_loadu_pd(L + 8);
+		const __m256d l3 = _mm256_loadu_pd(L + 12);
+
+		for (int i = 0; i < 4; ++i, D += 4, R += 4)
+		{
+			__m256d d = _mm256_mul_pd(l0, _mm256_broadcast_sd(R));
+			d = _mm256_add_pd(d, _mm256_mul_pd(l1, _mm256_broadcast_sd(R + 1)));
+			d = _mm256_add_pd(d, _mm256_mul_pd(l2, _mm256_broadcast_sd(R + 2)));
+			d = _mm256_add_pd(d, _mm256_mul_pd(l3, _mm256_broadcast_sd(R + 3)));
+			_mm256_storeu_pd(D, d);
+		}
+#elif defined(OFBMATH_SSE2)
+		const __m128d l0a = _mm_loadu_pd(L), l0b = _mm_loadu_pd(L + 2);
+		const __m128d l1a = _mm_loadu_pd(L + 4), l1b = _mm_loadu_pd(L + 6);
+		const __m128d l2a = _mm_loadu_pd(L + 8), l2b = _mm_loadu_pd(L + 10);
+		const __m128d l3a = _mm_loadu_pd(L + 12), l3b = _mm_loadu_pd(L + 14);
+
+		for (int i = 0; i < 4; ++i, D += 4, R += 4)
 		{
-			for (int i = 0; i < 4; ++i)
-			{
-				double tmp = 0;
-				for (int k = 0; k < 4; ++k)
-				{
-					tmp += lhs.m[i + k * 4] * rhs.m[k + j * 4];
-				}
-				res.m[i + j * 4] = tmp;
-			}
+			const __m128d r0 = _mm_set1_pd(R[0]);
+			const __m128d r1 = _mm_set1_pd(R[1]);
+			const __m128d r2 = _mm_set1_pd(R[2]);
+			const __m128d r3 = _mm_set1_pd(R[3]);
+
+			__m128d a = _mm_mul_pd(l0a, r0);
+			__m128d b = _mm_mul_pd(l0b, r0);
+			a = _mm_add_pd(a, _mm_mul_pd(l1a, r1));
+			b = _mm_add_pd(b, _mm_mul_pd(l1b, r1));
+			a = _mm_add_pd(a, _mm_mul_pd(l2a, r2));
+			b = _mm_add_pd(b, _mm_mul_pd(l2b, r2));
+			a = _mm_add_pd(a, _mm_mul_pd(l3a, r3));
+			b = _mm_add_pd(b, _mm_mul_pd(l3b, r3));
+
+			_mm_storeu_pd(D, a);
+			_mm_storeu_pd(D + 2, b);
 		}
+#elif defined(OFBMATH_NEON)
+		const float64x2_t l0a = vld1q_f64(L), l0b = vld1q_f64(L + 2);
+		const float64x2_t l1a = vld1q_f64(L + 4), l1b = vld1q_f64(L + 6);
+		const float64x2_t l2a = vld1q_f64(L + 8), l2b = vld1q_f64(L + 10);
+		const float64x2_t l3a = vld1q_f64(L + 12), l3b = vld1q_f64(L + 14);
+
+		for (int i = 0; i < 4; ++i, D += 4, R += 4)
+		{
+			const float64x2_t r0 = vdupq_n_f64(R[0]);
+			const float64x2_t r1 = vdupq_n_f64(R[1]);
+			const float64x2_t r2 = vdupq_n_f64(R[2]);
+			const float64x2_t r3 = vdupq_n_f64(R[3]);
+
+			float64x2_t a = vmulq_f64(l0a, r0);
+			float64x2_t b = vmulq_f64(l0b, r0);
+			a = vaddq_f64(a, vmulq_f64(l1a, r1));
+			b = vaddq_f64(b, vmulq_f64(l1b, r1));
+			a = vaddq_f64(a, vmulq_f64(l2a, r2));
+			b = vaddq_f64(b, vmulq_f64(l2b, r2));
+			a = vaddq_f64(a, vmulq_f64(l3a, r3));
+			b = vaddq_f64(b, vmulq_f64(l3b, r3));
+
+			vst1q_f64(D, a);
+			vst1q_f64(D + 2, b);
+		}
+#else
+		double tmp[16];
+		double *T = tmp;
+		for (int i = 0; i < 4; i++, T += 4, R += 4)
+		{
+			T[0] = L[0] * R[0] + L[4] * R[1] + L[8] * R[2] + L[12] * R[3];
+			T[1] = L[1] * R[0] + L[5] * R[1] + L[9] * R[2] + L[13] * R[3];
+			T[2] = L[2] * R[0] + L[6] * R[1] + L[10] * R[2] + L[14] * R[3];
+			T[3] = L[3] * R[0] + L[7] * R[1] + L[11] * R[2] + L[15] * R[3];
+		}
+		for (int i = 0; i < 16; ++i)
+			D[i] = tmp[i];
+#endif
+	}
+
+
+	OFBMatrix operator*(const OFBMatrix& lhs, const OFBMatrix& rhs)
+	{
+		OFBMatrix res;
+		MatrixMultKernel(res.m, lhs.m, rhs.m);
 		return res;
 	}
 
@@ -109,28 +196,57 @@ namespace ofbx
 	}
 
 
+	// M = M * rotation around the axis, in place on the 3x3 part
+	//  only the two columns of the other axes change, the terms are summed in the matrix product order
+	static inline void RotateAxis(double *M, int axis, double c, double s)
+	{
+		static const int cols[3][2] = { { 1, 2 }, { 0, 2 }, { 0, 1 } };
+		const int a = cols[axis][0];
+		const int b = cols[axis][1];
+
+		// rotation columns a and b, X and Z put +s below the diagonal, Y above it
+		const double ab = (1 == axis) ? -s : s;	// R(b, a)
+		const double ba = -ab;					// R(a, b)
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const double ma = M[i + a * 4];
+			const double mb = M[i + b * 4];
+			M[i + a * 4] = ma * c + mb * ab;
+			M[i + b * 4] = ma * ba + mb * c;
+		}
+	}
+
+
 	OFBMatrix getRotationMatrix(const OFBVector3& euler, OFBRotationOrder order)
 	{
-		OFBMatrix rx = rotationX(euler.x * TO_RAD);
-		OFBMatrix ry = rotationY(euler.y * TO_RAD);
-		OFBMatrix rz = rotationZ(euler.z * TO_RAD);
+		// the product of the axis matrices in closed form, the composition order of the euler mode
+		//  is applied from the left: XYZ = Rz * Ry * Rx
+		int axes[3] = { 2, 1, 0 };
 		switch (order) {
 		default:
 		case OFBRotationOrder::eSPHERIC_XYZ:
 			assert(false);
-		case OFBRotationOrder::eEULER_XYZ:
-			return rz * ry * rx;
-		case OFBRotationOrder::eEULER_XZY:
-			return ry * rz * rx;
-		case OFBRotationOrder::eEULER_YXZ:
-			return rz * rx * ry;
-		case OFBRotationOrder::eEULER_YZX:
-			return rx * rz * ry;
-		case OFBRotationOrder::eEULER_ZXY:
-			return ry * rx * rz;
-		case OFBRotationOrder::eEULER_ZYX:
-			return rx * ry * rz;
+		case OFBRotationOrder::eEULER_XYZ: axes[0] = 2; axes[1] = 1; axes[2] = 0; break;
+		case OFBRotationOrder::eEULER_XZY: axes[0] = 1; axes[1] = 2; axes[2] = 0; break;
+		case OFBRotationOrder::eEULER_YXZ: axes[0] = 2; axes[1] = 0; axes[2] = 1; break;
+		case OFBRotationOrder::eEULER_YZX: axes[0] = 0; axes[1] = 2; axes[2] = 1; break;
+		case OFBRotationOrder::eEULER_ZXY: axes[0] = 1; axes[1] = 0; axes[2] = 2; break;
+		case OFBRotationOrder::eEULER_ZYX: axes[0] = 0; axes[1] = 1; axes[2] = 2; break;
 		}
+
+		const double angles[3] = { euler.x * TO_RAD, euler.y * TO_RAD, euler.z * TO_RAD };
+		double c[3], s[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			c[i] = cos(angles[i]);
+			s[i] = sin(angles[i]);
+		}
+
+		OFBMatrix m = makeIdentity();
+		for (int i = 0; i < 3; ++i)
+			RotateAxis(m.m, axes[i], c[axes[i]], s[axes[i]]);
+		return m;
 	}
 
 	double	QuaternionNorm(const OFBVector4 &q)
@@ -241,6 +357,57 @@ namespace ofbx
 		res.z = DotProduct(in1, { in2.m[2], in2.m[6], in2.m[10] }) + in2.m[14];
 	}
 
+	void VectorTransformArray(OFBVector3 *res, const OFBVector3 *in, const int count, const OFBMatrix &m)
+	{
+#if defined(OFBMATH_AVX) || defined(OFBMATH_SSE2)
+		// x and y of the result in one register, z in the low lane of the other one
+		const __m128d c0 = _mm_loadu_pd(m.m), c0z = _mm_load_sd(m.m + 2);
+		const __m128d c1 = _mm_loadu_pd(m.m + 4), c1z = _mm_load_sd(m.m + 6);
+		const __m128d c2 = _mm_loadu_pd(m.m + 8), c2z = _mm_load_sd(m.m + 10);
+		const __m128d c3 = _mm_loadu_pd(m.m + 12), c3z = _mm_load_sd(m.m + 14);
+
+		for (int i = 0; i < count; ++i)
+		{
+			const __m128d x = _mm_set1_pd(in[i].x);
+			const __m128d y = _mm_set1_pd(in[i].y);
+			const __m128d z = _mm_set1_pd(in[i].z);
+
+			__m128d xy = _mm_mul_pd(x, c0);
+			__m128d zz = _mm_mul_sd(x, c0z);
+			xy = _mm_add_pd(xy, _mm_mul_pd(y, c1));
+			zz = _mm_add_sd(zz, _mm_mul_sd(y, c1z));
+			xy = _mm_add_pd(xy, _mm_mul_pd(z, c2));
+			zz = _mm_add_sd(zz, _mm_mul_sd(z, c2z));
+			xy = _mm_add_pd(xy, c3);
+			zz = _mm_add_sd(zz, c3z);
+
+			_mm_storeu_pd(&res[i].x, xy);
+			_mm_store_sd(&res[i].z, zz);
+		}
+#elif defined(OFBMATH_NEON)
+		const float64x2_t c0 = vld1q_f64(m.m), c1 = vld1q_f64(m.m + 4), c2 = vld1q_f64(m.m + 8), c3 = vld1q_f64(m.m + 12);
+
+		for (int i = 0; i < count; ++i)
+		{
+			const OFBVector3 v = in[i];
+
+			float64x2_t xy = vmulq_f64(vdupq_n_f64(v.x), c0);
+			xy = vaddq_f64(xy, vmulq_f64(vdupq_n_f64(v.y), c1));
+			xy = vaddq_f64(xy, vmulq_f64(vdupq_n_f64(v.z), c2));
+			xy = vaddq_f64(xy, c3);
+
+			vst1q_f64(&res[i].x, xy);
+			res[i].z = v.x * m.m[2] + v.y * m.m[6] + v.z * m.m[10] + m.m[14];
+		}
+#else
+		for (int i = 0; i < count; ++i)
+		{
+			const OFBVector3 v = in[i];
+			VectorTransform(res[i], v, m);
+		}
+#endif
+	}
+
 	void VectorTransform33(OFBVector3 &res, const OFBVector3 &in1, const OFBMatrix &in2)
 	{
 		res.x = DotProduct(in1, { in2.m[0], in2.m[4], in2.m[8] });
@@ -489,23 +656,41 @@ namespace ofbx
 
 	OFBMatrix &MatrixMult(OFBMatrix &dest, const OFBMatrix &M1, const OFBMatrix &M2)
 	{
-		
-		const double*  L;
-		const double*  R;
-
-		L = &M1.m[0];
-		R = &M2.m[0];
-
-		double* D = &dest.m[0];
-		for (int i = 0; i<4; i++, D += 4, R += 4)
-		{
-			D[0] = L[0] * R[0] + L[4] * R[1] + L[8] * R[2] + L[12] * R[3];
-			D[1] = L[1] * R[0] + L[5] * R[1] + L[9] * R[2] + L[13] * R[3];
-			D[2] = L[2] * R[0] + L[6] * R[1] + L[10] * R[2] + L[14] * R[3];
-			D[3] = L[3] * R[0] + L[7] * R[1] + L[11] * R[2] + L[15] * R[3];
-		}
+		MatrixMultKernel(dest.m, M1.m, M2.m);
 		return dest;
 	}
 
+	bool MatrixInverse(OFBMatrix &dest, const OFBMatrix &src)
+	{
+		const double *m = src.m;
+		double inv[16];
+
+		inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+		inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+		inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+		inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+		inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+		inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+		inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+		inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+		inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+		inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+		inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+		inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+		inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+		inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+		inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+		inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+		const double det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+		if (0.0 == det)
+			return false;
+
+		const double inv_det = 1.0 / det;
+		for (int i = 0; i < 16; ++i)
+			dest.m[i] = inv[i] * inv_det;
+		return true;
+	}
+
 
 };
\ No newline at end of file
@@ -41,6 +41,8 @@ namespace ofbx
 	void VectorNormalize(OFBVector3	&v);
 
 	void VectorTransform(OFBVector3 &res, const OFBVector3 &in1, const OFBMatrix &in2);
+	// res[i] = m * in[i] for count points, res may be the same array as in
+	void VectorTransformArray(OFBVector3 *res, const OFBVector3 *in, const int count, const OFBMatrix &m);
 	void VectorTransform33(OFBVector3 &res, const OFBVector3 &in1, const OFBMatrix &in2);
 	void VectorRotate(OFBVector3 &res, const OFBVector3 &in, const OFBVector4 &q);
 
@@ -72,6 +74,8 @@ namespace ofbx
 	OFBMatrix operator * (const OFBMatrix&, const OFBMatrix&);
 
 	OFBMatrix &MatrixMult(OFBMatrix &dest, const OFBMatrix &M1, const OFBMatrix &M2);
+	// general 4x4 inverse, returns false and leaves dest untouched when the matrix is singular
+	bool MatrixInverse(OFBMatrix &dest, const OFBMatrix &src);
 
 	// camera matrix
 
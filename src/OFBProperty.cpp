@@ -1,6 +1,11 @@
 
 #include "OFBProperty.h"
 #include "ofbx.h"
+#include <algorithm>
+#include <stdio.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 // OFBProperty.cpp
 //
@@ -28,7 +33,7 @@ namespace ofbx
 		{
 			pParent = _pParent;
 			memset(mName.raw, 0, sizeof(char)* 32);
-			sprintf_s(mName.raw, sizeof(char)* 32, "%s", name);
+			snprintf(mName.raw, sizeof(char)* 32, "%s", name);
 
 			pParent->PropertyAdd(this);
 			lSuccess = true;
@@ -37,6 +42,12 @@ namespace ofbx
 		return lSuccess;
 	}
 
+	bool PropertyBase::GetData(void *buffer, int bufferSize, EvaluationContext &context) const
+	{
+		// static properties don't cache anything, the time based evaluation is safe here
+		return GetData(buffer, bufferSize, &context.GetTime());
+	}
+
 	//////////////////////////////////////////////////////////////////////////////////////////////
 	// Property Animatable
 
@@ -61,16 +72,25 @@ namespace ofbx
 		{
 			mBaseLayerNode = pAnimNode;
 			if (nullptr != mBaseLayerNode)
+			{
+				// the node could be linked from an earlier take, it starts a new chain now
+				((AnimationCurveNode*)pAnimNode)->LinkNext(nullptr);
 				mIsAnimated = true;
+			}
 		}
-		else
+		else if (nullptr != pAnimNode)
 		{
 			AnimationCurveNode *pLast = (AnimationCurveNode*)mBaseLayerNode;
 
-			while (nullptr != pLast->GetNext())
+			while (pLast != pAnimNode && nullptr != pLast->GetNext())
 			{
 				pLast = pLast->GetNext();
 			}
+			// already in the chain
+			if (pLast == pAnimNode)
+				return;
+
+			((AnimationCurveNode*)pAnimNode)->LinkNext(nullptr);
 			pLast->LinkNext(pAnimNode);
 		}
 	}
@@ -109,33 +129,62 @@ namespace ofbx
 		}
 	}
 
+	void ComputeAnimationNode(double *Data, const int DataCount, const AnimationCurveNode *pBaseNode, EvaluationContext &context)
+	{
+		pBaseNode->Evaluate(Data, context);
+
+		const AnimationCurveNode *pNext = pBaseNode->GetNext();
+		while (nullptr != pNext)
+		{
+			AnimationLayer *pLayer = pNext->getLayer();
+
+			if (false == pLayer->Mute)
+			{
+				double weight;
+				pLayer->Weight.GetData(&weight, sizeof(double), context);
+				weight *= 0.01;
+
+				double temp[3];
+				pNext->Evaluate(temp, context);
+
+				for (int i = 0; i < DataCount; ++i)
+				{
+					Data[i] += weight * temp[i];
+				}
+			}
+
+			pNext = pNext->GetNext();
+		}
+	}
+
 	/////////////////////////////////////////////////////////////////////////////////////////////
 	// Property List
 
 	bool PropertyList::Add(PropertyBase *pProp)
 	{
+		pProp->pNext = nullptr;
+
 		if (nullptr == mProperty)
 		{
 			mProperty = pProp;
-			mProperty->pNext = nullptr;
 		}
 		else
 		{
 			// list prop to a last list item
-			PropertyBase *prop = mProperty;
-			while (nullptr != prop->GetNext())
-			{
-				prop = prop->GetNext();
-			}
-			prop->pNext = pProp;
+			mLast->pNext = pProp;
 		}
+		mLast = pProp;
+		mCount += 1;
 		return true;
 	}
 
 	PropertyList::PropertyList(Object *pParent)
 		: mParent(pParent)
+		, mIndex(nullptr)
 	{
 		mProperty = nullptr;
+		mLast = nullptr;
+		mCount = 0;
 	}
 
 	PropertyBase		*PropertyList::GetFirst() const
@@ -143,13 +192,75 @@ namespace ofbx
 		return mProperty;
 	}
 
-	PropertyBase		*PropertyList::Find(const char *name) const
+	u32 PropertyList::HashName(const char *name, size_t length)
+	{
+		u32 hash = 2166136261u;
+		for (size_t i = 0; i < length; ++i)
+		{
+			hash ^= (u8)name[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// one index per concrete class, built from its first instance which does a lookup
+	//  every object type has one implementation, the property count tells apart an instance with extra properties
+	static std::mutex							s_indexLock;
+	static std::unordered_map<u64, std::unique_ptr<PropertyIndex>>	s_indices;
+
+	const PropertyIndex *PropertyList::GetIndex() const
+	{
+		const PropertyIndex *index = mIndex.load(std::memory_order_acquire);
+		if (nullptr != index)
+			return index;
+
+		std::lock_guard<std::mutex> lock(s_indexLock);
+
+		const u64 key = ((u64)mParent->getType() << 32) | (u32)mCount;
+		std::unique_ptr<PropertyIndex> &entry = s_indices[key];
+		if (!entry)
+		{
+			entry.reset(new PropertyIndex());
+			entry->count = mCount;
+			entry->valid = true;
+			entry->entries.reserve(mCount);
+
+			for (const PropertyBase *prop = mProperty; nullptr != prop; prop = prop->GetNext())
+			{
+				// a property which isn't a member of the object has no stable offset
+				const ptrdiff_t offset = (const char*)prop - (const char*)mParent;
+				if (prop->GetParent() != mParent || offset < 0 || offset > 65536)
+				{
+					entry->valid = false;
+					break;
+				}
+
+				PropertyIndex::Entry item;
+				item.length = (u32)strlen(prop->GetName());
+				item.hash = HashName(prop->GetName(), item.length);
+				item.offset = offset;
+				entry->entries.push_back(item);
+			}
+
+			// equal hashes keep the list order, so the first property of a name wins like in the list walk
+			std::stable_sort(entry->entries.begin(), entry->entries.end(), [](const PropertyIndex::Entry &a, const PropertyIndex::Entry &b) {
+				return a.hash < b.hash;
+			});
+		}
+
+		index = entry.get();
+		mIndex.store(index, std::memory_order_release);
+		return index;
+	}
+
+	PropertyBase *PropertyList::FindLinear(const char *name, size_t length) const
 	{
 		PropertyBase *prop = mProperty;
 
 		while (nullptr != prop)
 		{
-			if (0 == strcmp(prop->GetName(), name))
+			const char *propName = prop->GetName();
+			if (0 == strncmp(propName, name, length) && '\0' == propName[length])
 			{
 				return prop;
 			}
@@ -159,6 +270,42 @@ namespace ofbx
 		return nullptr;
 	}
 
+	PropertyBase		*PropertyList::Find(const char *name) const
+	{
+		const size_t length = strlen(name);
+		return Find(name, length, HashName(name, length));
+	}
+
+	PropertyBase		*PropertyList::Find(const char *name, size_t length, u32 hash) const
+	{
+		if (nullptr == mProperty)
+			return nullptr;
+
+		const PropertyIndex *index = GetIndex();
+
+		// properties added to this instance only are not in the class index
+		if (!index->valid || index->count != mCount)
+			return FindLinear(name, length);
+
+		PropertyIndex::Entry key;
+		key.hash = hash;
+		auto iter = std::lower_bound(index->entries.begin(), index->entries.end(), key, [](const PropertyIndex::Entry &a, const PropertyIndex::Entry &b) {
+			return a.hash < b.hash;
+		});
+
+		for (; iter != index->entries.end() && iter->hash == hash; ++iter)
+		{
+			if (iter->length != length)
+				continue;
+
+			PropertyBase *prop = (PropertyBase*)((char*)mParent + iter->offset);
+			if (0 == memcmp(prop->GetName(), name, length))
+				return prop;
+		}
+
+		return nullptr;
+	}
+
 	void PropertyList::DetachAnimNodes()
 	{
 		PropertyBase *prop = mProperty;
@@ -190,7 +337,7 @@ namespace ofbx
 
 				if (nullptr != pNode)
 				{
-					pAnimatable->AttachAnimationNode(pNode);
+					AttachSceneAnimationNode(mParent->getScene(), pAnimatable, pNode);
 					count += 1;
 				}
 
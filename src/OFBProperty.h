@@ -9,7 +9,9 @@
 
 #include "OFBTypes.h"
 #include "OFBTime.h"
+#include <string.h>
 #include <vector>
+#include <atomic>
 
 
 namespace ofbx
@@ -19,6 +21,8 @@ namespace ofbx
 	struct AnimationCurveNode;
 	struct AnimationLayer;
 	struct Object;
+	struct IScene;
+	struct EvaluationContext;
 
 	class PropertyBase;
 	class PropertyList;
@@ -56,6 +60,22 @@ namespace ofbx
 	///////////////////////////////////////////////////////////////////////////////////////////////
 	// PropertyList
 
+	// name lookup table of one concrete object class, shared by all its instances
+	//  a property is stored as a byte offset from the owner object, every instance lays them out the same way
+	struct PropertyIndex
+	{
+		struct Entry
+		{
+			u32			hash;
+			u32			length;
+			ptrdiff_t	offset;
+		};
+
+		std::vector<Entry>	entries;	// sorted by hash
+		int					count;		// properties of the class
+		bool				valid;		// false when the properties can't be addressed by an offset
+	};
+
 	class PropertyList
 	{
 	public:
@@ -68,6 +88,11 @@ namespace ofbx
 
 		PropertyBase		*GetFirst() const;
 		PropertyBase		*Find(const char *name) const;
+		// name is not zero terminated, hash is HashName(name, length)
+		PropertyBase		*Find(const char *name, size_t length, u32 hash) const;
+
+		// 32-bit FNV-1a of the name
+		static u32 HashName(const char *name, size_t length);
 
 		// attach nodes from stack
 		int AttachAnimNodes(const AnimationLayer *pLayer);
@@ -78,6 +103,14 @@ namespace ofbx
 
 		Object				*mParent;
 		PropertyBase		*mProperty;	// first property, it has pointer to the object next one
+		PropertyBase		*mLast;
+		int					mCount;
+
+		// class index, resolved on the first lookup
+		mutable std::atomic<const PropertyIndex*>	mIndex;
+
+		const PropertyIndex *GetIndex() const;
+		PropertyBase *FindLinear(const char *name, size_t length) const;
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -142,6 +175,8 @@ namespace ofbx
 		virtual void SetData(void *pData) = 0;
 
 		virtual bool GetData(void *buffer, int bufferSize, const OFBTime *lTime) const = 0;
+		// evaluate at the context time, writes no property cache
+		virtual bool GetData(void *buffer, int bufferSize, EvaluationContext &context) const;
 
 		const char *GetName() const {
 			return mName.raw;
@@ -150,6 +185,9 @@ namespace ofbx
 		bool Modified() const {
 			return mIsDirty;
 		}
+		void SetModified(bool modified) {
+			mIsDirty = modified;
+		}
 
 		virtual bool IsAnimatable() { return false; }
 
@@ -197,6 +235,8 @@ namespace ofbx
 
 		//void Retrieve(IElementProperty *pElementProperty);
 
+		using PropertyBase::GetData;
+
 		void SetData(void *buffer) override
 		{
 			const int size = GetBufferSize(buffer);
@@ -204,6 +244,7 @@ namespace ofbx
 			if (size > 0 && GetValuePtr())
 			{
 				memcpy(GetValuePtr(), buffer, size);
+				mIsDirty = true;
 			}
 
 		}
@@ -235,6 +276,7 @@ namespace ofbx
 			if (GetValuePtr())
 			{
 				*(tType*)GetValuePtr() = pValue;
+				mIsDirty = true;
 			}
 		}
 
@@ -306,11 +348,17 @@ namespace ofbx
 
 	// TODO: rules to compute quaternion rotation
 	void ComputeAnimationNode(double *Data, const int DataCount, const AnimationCurveNode *pBaseNode, const OFBTime &lTime);
+	void ComputeAnimationNode(double *Data, const int DataCount, const AnimationCurveNode *pBaseNode, EvaluationContext &context);
+
+	// attach the node through the scene, so the next PrepTakeConnections() detaches the property again
+	void AttachSceneAnimationNode(const IScene &scene, PropertyAnimatable *pProp, const AnimationCurveNode *pAnimNode);
 
 	template <class tType, PropertyType pPT> class PropertyAnimatableT : public PropertyAnimatable
 	{
 	public:
 
+		using PropertyBase::GetData;
+
 		void SetData(void *buffer) override
 		{
 			const int size = GetBufferSize(buffer);
@@ -359,6 +407,25 @@ namespace ofbx
 			return lSuccess;
 		}
 
+		bool GetData(void *buffer, int bufferSize, EvaluationContext &context) const override
+		{
+			const int size = GetDataSize();
+			if (size <= 0 || bufferSize < size)
+				return false;
+
+			if (mIsAnimated)
+			{
+				double data[4] = { 0.0, 0.0, 0.0, 0.0 };
+				ComputeAnimationNode(data, GetDataCount(), mBaseLayerNode, context);
+				memcpy(buffer, data, size);
+			}
+			else
+			{
+				memcpy(buffer, GetValuePtr(), size);
+			}
+			return true;
+		}
+
 		void operator = (tType pValue)
 		{
 			SetData(&pValue);
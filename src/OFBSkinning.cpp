@@ -0,0 +1,401 @@
+// OFBSkinning.cpp
+//
+// Sergei <Neill3d> Solokhin (https://github.com/Neill3d/OpenFBX)
+//
+
+#include "OFBSkinning.h"
+#include <math.h>
+#include <algorithm>
+
+// same compile time selection as the OFBMath kernels, OFBMATH_NO_SIMD forces the scalar code
+#if !defined(OFBMATH_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OFBSKIN_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define OFBSKIN_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace ofbx
+{
+	// vertices per deform job
+	static const int SKIN_JOB_MIN_VERTICES = 1024;
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// OFBSkinDeformer
+
+	OFBSkinDeformer::OFBSkinDeformer()
+	{
+		mMesh = nullptr;
+		mVertices = nullptr;
+		mNormals = nullptr;
+		mFloatVertices = nullptr;
+		mFloatNormals = nullptr;
+		mVertexCount = 0;
+		mInfluences = 0;
+	}
+
+	void OFBSkinDeformer::Clear()
+	{
+		mMesh = nullptr;
+		mVertices = nullptr;
+		mNormals = nullptr;
+		mFloatVertices = nullptr;
+		mFloatNormals = nullptr;
+		mVertexCount = 0;
+		mInfluences = 0;
+
+		mBones.clear();
+		mLinkMatrices.clear();
+		mBindMatrices.clear();
+		mIndices.clear();
+		mWeights.clear();
+	}
+
+	bool OFBSkinDeformer::Init(const Mesh &mesh, int max_influences)
+	{
+		Clear();
+
+		const Geometry *geometry = mesh.getGeometry();
+		if (nullptr == geometry)
+			return false;
+		const Skin *skin = geometry->getSkin();
+		if (nullptr == skin || 0 == skin->getClusterCount())
+			return false;
+
+		const int vertex_count = geometry->getVertexCount();
+		if (0 == vertex_count)
+			return false;
+
+		mMesh = &mesh;
+		// read the stored precision, the double accessors would keep a converted copy of the float storage
+		if (geometry->isFloatStorage())
+		{
+			mFloatVertices = geometry->getFloatVertices();
+			mFloatNormals = geometry->getFloatNormals();
+		}
+		else
+		{
+			mVertices = geometry->getVertices();
+			mNormals = geometry->getNormals();
+		}
+		mVertexCount = vertex_count;
+		mInfluences = std::max(1, std::min((int)MAX_INFLUENCES, max_influences));
+
+		const int cluster_count = skin->getClusterCount();
+		mBones.resize(cluster_count, nullptr);
+		mLinkMatrices.resize(cluster_count);
+		mBindMatrices.resize(cluster_count);
+
+		const size_t table_size = (size_t)vertex_count * mInfluences;
+		mIndices.resize(table_size, 0);
+		mWeights.resize(table_size, 0.0f);
+		std::vector<u8> used(vertex_count, 0);
+
+		for (int i = 0; i < cluster_count; ++i)
+		{
+			const Cluster *cluster = skin->getCluster(i);
+
+			const Object *link = cluster->getLink();
+			mBones[i] = (nullptr != link && link->isNode()) ? static_cast<const Model*>(link) : nullptr;
+
+			mLinkMatrices[i] = cluster->getTransformLinkMatrix();
+			OFBMatrix inv_link;
+			if (!MatrixInverse(inv_link, mLinkMatrices[i]))
+				inv_link = makeIdentity();
+			mBindMatrices[i] = inv_link * cluster->getTransformMatrix();
+
+			const int *indices = cluster->getIndices();
+			const double *weights = cluster->getWeights();
+			const int count = std::min(cluster->getIndicesCount(), cluster->getWeightsCount());
+
+			for (int j = 0; j < count; ++j)
+			{
+				const int v = indices[j];
+				const float w = (float)weights[j];
+				if (v < 0 || v >= vertex_count || w <= 0.0f)
+					continue;
+
+				int *row_indices = &mIndices[(size_t)v * mInfluences];
+				float *row_weights = &mWeights[(size_t)v * mInfluences];
+
+				int slot = used[v];
+				if (slot < mInfluences)
+				{
+					used[v] += 1;
+				}
+				else
+				{
+					// the row is full, replace the smallest weight
+					slot = 0;
+					for (int k = 1; k < mInfluences; ++k)
+					{
+						if (row_weights[k] < row_weights[slot])
+							slot = k;
+					}
+					if (row_weights[slot] >= w)
+						continue;
+				}
+
+				row_indices[slot] = i;
+				row_weights[slot] = w;
+			}
+		}
+
+		for (int v = 0; v < vertex_count; ++v)
+		{
+			int *row_indices = &mIndices[(size_t)v * mInfluences];
+			float *row_weights = &mWeights[(size_t)v * mInfluences];
+
+			// biggest weight first, the rows are short so an insertion sort is enough
+			for (int k = 1; k < used[v]; ++k)
+			{
+				const int index = row_indices[k];
+				const float weight = row_weights[k];
+
+				int slot = k;
+				for (; slot > 0 && row_weights[slot - 1] < weight; --slot)
+				{
+					row_indices[slot] = row_indices[slot - 1];
+					row_weights[slot] = row_weights[slot - 1];
+				}
+				row_indices[slot] = index;
+				row_weights[slot] = weight;
+			}
+
+			float total = 0.0f;
+			for (int k = 0; k < used[v]; ++k)
+				total += row_weights[k];
+
+			if (total > 0.0f)
+			{
+				const float inv_total = 1.0f / total;
+				for (int k = 0; k < used[v]; ++k)
+					row_weights[k] *= inv_total;
+			}
+		}
+
+		return true;
+	}
+
+	void OFBSkinDeformer::ComputeSkinMatrices(OFBMatrix *pSkin, const OFBMatrix *pBoneGlobal, const OFBMatrix &meshGlobal) const
+	{
+		OFBMatrix inv_mesh;
+		if (!MatrixInverse(inv_mesh, meshGlobal))
+			inv_mesh = makeIdentity();
+
+		for (size_t i = 0, count = mBones.size(); i < count; ++i)
+		{
+			const OFBMatrix bone = inv_mesh * pBoneGlobal[i];
+			MatrixMult(pSkin[i], bone, mBindMatrices[i]);
+		}
+	}
+
+	void OFBSkinDeformer::ComputeSkinMatrices(OFBMatrix *pSkin, const ScenePose &pose) const
+	{
+		const OFBMatrix *globals = pose.GetGlobalMatrices();
+
+		std::vector<OFBMatrix> bones(mBones.size());
+		for (size_t i = 0, count = mBones.size(); i < count; ++i)
+		{
+			const int index = pose.FindModelIndex(mBones[i]);
+			bones[i] = (index >= 0) ? globals[index] : mLinkMatrices[i];
+		}
+
+		const int mesh_index = pose.FindModelIndex(mMesh);
+		const OFBMatrix mesh_global = (mesh_index >= 0) ? globals[mesh_index] : makeIdentity();
+
+		if (!bones.empty())
+			ComputeSkinMatrices(pSkin, bones.data(), mesh_global);
+	}
+
+	void OFBSkinDeformer::DeformRange(const OFBMatrix *pSkin, OFBVector3 *pPositions, OFBVector3 *pNormals, int begin, int end) const
+	{
+		if (nullptr == mNormals && nullptr == mFloatNormals)
+			pNormals = nullptr;
+
+		const int width = mInfluences;
+		const int *row_indices = mIndices.data() + (size_t)begin * width;
+		const float *row_weights = mWeights.data() + (size_t)begin * width;
+
+		for (int v = begin; v < end; ++v, row_indices += width, row_weights += width)
+		{
+			OFBVector3 p, n = Vector_Zero();
+			if (nullptr != mVertices)
+			{
+				p = mVertices[v];
+				if (nullptr != pNormals) n = mNormals[v];
+			}
+			else
+			{
+				p = { mFloatVertices[v].x, mFloatVertices[v].y, mFloatVertices[v].z };
+				if (nullptr != pNormals) n = { mFloatNormals[v].x, mFloatNormals[v].y, mFloatNormals[v].z };
+			}
+
+			// the biggest weight goes first, a zero there means the vertex is not bound to any bone
+			if (row_weights[0] <= 0.0f)
+			{
+				if (pPositions) pPositions[v] = p;
+				if (pNormals) pNormals[v] = n;
+				continue;
+			}
+
+			OFBVector3 tp, tn;
+#if defined(OFBSKIN_SSE2)
+			// blended columns, rows 0-1 in a and rows 2-3 in b
+			__m128d a0 = _mm_setzero_pd(), b0 = _mm_setzero_pd();
+			__m128d a1 = _mm_setzero_pd(), b1 = _mm_setzero_pd();
+			__m128d a2 = _mm_setzero_pd(), b2 = _mm_setzero_pd();
+			__m128d a3 = _mm_setzero_pd(), b3 = _mm_setzero_pd();
+
+			for (int k = 0; k < width && row_weights[k] > 0.0f; ++k)
+			{
+				const double *M = pSkin[row_indices[k]].m;
+				const __m128d w = _mm_set1_pd((double)row_weights[k]);
+
+				a0 = _mm_add_pd(a0, _mm_mul_pd(w, _mm_loadu_pd(M)));
+				b0 = _mm_add_pd(b0, _mm_mul_pd(w, _mm_loadu_pd(M + 2)));
+				a1 = _mm_add_pd(a1, _mm_mul_pd(w, _mm_loadu_pd(M + 4)));
+				b1 = _mm_add_pd(b1, _mm_mul_pd(w, _mm_loadu_pd(M + 6)));
+				a2 = _mm_add_pd(a2, _mm_mul_pd(w, _mm_loadu_pd(M + 8)));
+				b2 = _mm_add_pd(b2, _mm_mul_pd(w, _mm_loadu_pd(M + 10)));
+				a3 = _mm_add_pd(a3, _mm_mul_pd(w, _mm_loadu_pd(M + 12)));
+				b3 = _mm_add_pd(b3, _mm_mul_pd(w, _mm_loadu_pd(M + 14)));
+			}
+
+			const __m128d px = _mm_set1_pd(p.x), py = _mm_set1_pd(p.y), pz = _mm_set1_pd(p.z);
+			__m128d pa = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(a0, px), _mm_mul_pd(a1, py)), _mm_mul_pd(a2, pz)), a3);
+			__m128d pb = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(b0, px), _mm_mul_pd(b1, py)), _mm_mul_pd(b2, pz)), b3);
+			_mm_storeu_pd(&tp.x, pa);
+			_mm_store_sd(&tp.z, pb);
+
+			const __m128d nx = _mm_set1_pd(n.x), ny = _mm_set1_pd(n.y), nz = _mm_set1_pd(n.z);
+			__m128d na = _mm_add_pd(_mm_add_pd(_mm_mul_pd(a0, nx), _mm_mul_pd(a1, ny)), _mm_mul_pd(a2, nz));
+			__m128d nb = _mm_add_pd(_mm_add_pd(_mm_mul_pd(b0, nx), _mm_mul_pd(b1, ny)), _mm_mul_pd(b2, nz));
+			_mm_storeu_pd(&tn.x, na);
+			_mm_store_sd(&tn.z, nb);
+#elif defined(OFBSKIN_NEON)
+			float64x2_t a0 = vdupq_n_f64(0.0), b0 = vdupq_n_f64(0.0);
+			float64x2_t a1 = vdupq_n_f64(0.0), b1 = vdupq_n_f64(0.0);
+			float64x2_t a2 = vdupq_n_f64(0.0), b2 = vdupq_n_f64(0.0);
+			float64x2_t a3 = vdupq_n_f64(0.0), b3 = vdupq_n_f64(0.0);
+
+			for (int k = 0; k < width && row_weights[k] > 0.0f; ++k)
+			{
+				const double *M = pSkin[row_indices[k]].m;
+				const float64x2_t w = vdupq_n_f64((double)row_weights[k]);
+
+				a0 = vaddq_f64(a0, vmulq_f64(w, vld1q_f64(M)));
+				b0 = vaddq_f64(b0, vmulq_f64(w, vld1q_f64(M + 2)));
+				a1 = vaddq_f64(a1, vmulq_f64(w, vld1q_f64(M + 4)));
+				b1 = vaddq_f64(b1, vmulq_f64(w, vld1q_f64(M + 6)));
+				a2 = vaddq_f64(a2, vmulq_f64(w, vld1q_f64(M + 8)));
+				b2 = vaddq_f64(b2, vmulq_f64(w, vld1q_f64(M + 10)));
+				a3 = vaddq_f64(a3, vmulq_f64(w, vld1q_f64(M + 12)));
+				b3 = vaddq_f64(b3, vmulq_f64(w, vld1q_f64(M + 14)));
+			}
+
+			float64x2_t pa = vaddq_f64(vaddq_f64(vaddq_f64(vmulq_n_f64(a0, p.x), vmulq_n_f64(a1, p.y)), vmulq_n_f64(a2, p.z)), a3);
+			float64x2_t pb = vaddq_f64(vaddq_f64(vaddq_f64(vmulq_n_f64(b0, p.x), vmulq_n_f64(b1, p.y)), vmulq_n_f64(b2, p.z)), b3);
+			vst1q_f64(&tp.x, pa);
+			tp.z = vgetq_lane_f64(pb, 0);
+
+			float64x2_t na = vaddq_f64(vaddq_f64(vmulq_n_f64(a0, n.x), vmulq_n_f64(a1, n.y)), vmulq_n_f64(a2, n.z));
+			float64x2_t nb = vaddq_f64(vaddq_f64(vmulq_n_f64(b0, n.x), vmulq_n_f64(b1, n.y)), vmulq_n_f64(b2, n.z));
+			vst1q_f64(&tn.x, na);
+			tn.z = vgetq_lane_f64(nb, 0);
+#else
+			// blended 3x4 part of the skin matrices, column-major
+			double B[12] = { 0.0 };
+			for (int k = 0; k < width && row_weights[k] > 0.0f; ++k)
+			{
+				const double *M = pSkin[row_indices[k]].m;
+				const double w = (double)row_weights[k];
+				for (int c = 0; c < 4; ++c)
+				{
+					B[c * 3] += w * M[c * 4];
+					B[c * 3 + 1] += w * M[c * 4 + 1];
+					B[c * 3 + 2] += w * M[c * 4 + 2];
+				}
+			}
+
+			tp.x = B[0] * p.x + B[3] * p.y + B[6] * p.z + B[9];
+			tp.y = B[1] * p.x + B[4] * p.y + B[7] * p.z + B[10];
+			tp.z = B[2] * p.x + B[5] * p.y + B[8] * p.z + B[11];
+
+			tn.x = B[0] * n.x + B[3] * n.y + B[6] * n.z;
+			tn.y = B[1] * n.x + B[4] * n.y + B[7] * n.z;
+			tn.z = B[2] * n.x + B[5] * n.y + B[8] * n.z;
+#endif
+			if (pPositions)
+				pPositions[v] = tp;
+
+			// the blended matrix is used for normals as well, exact for rotations and uniform scaling
+			if (pNormals)
+			{
+				const double len = sqrt(tn.x * tn.x + tn.y * tn.y + tn.z * tn.z);
+				if (len > 0.0)
+				{
+					const double inv_len = 1.0 / len;
+					tn.x *= inv_len;
+					tn.y *= inv_len;
+					tn.z *= inv_len;
+				}
+				pNormals[v] = tn;
+			}
+		}
+	}
+
+	struct SkinDeformJob
+	{
+		const OFBSkinDeformer	*deformer;
+		const OFBMatrix			*skin;
+		OFBVector3				*positions;
+		OFBVector3				*normals;
+		int						begin;
+		int						end;
+	};
+
+	static void SkinDeformJobFunc(void *data)
+	{
+		SkinDeformJob *job = (SkinDeformJob*)data;
+		job->deformer->DeformRange(job->skin, job->positions, job->normals, job->begin, job->end);
+	}
+
+	void OFBSkinDeformer::Deform(const OFBMatrix *pSkin, OFBVector3 *pPositions, OFBVector3 *pNormals, int thread_count, JobProcessor processor, void *user_ptr) const
+	{
+		if (0 == mVertexCount || (nullptr == pPositions && nullptr == pNormals))
+			return;
+
+		if (thread_count <= 0)
+			thread_count = GetHardwareThreadCount();
+
+		if (nullptr == processor && thread_count <= 1)
+		{
+			DeformRange(pSkin, pPositions, pNormals, 0, mVertexCount);
+			return;
+		}
+
+		// a few ranges per thread so that the faster threads can pick up the rest
+		const int workers = (nullptr != processor) ? GetHardwareThreadCount() : thread_count;
+		const int job_size = std::max(SKIN_JOB_MIN_VERTICES, (mVertexCount + workers * 4 - 1) / (workers * 4));
+		const int job_count = (mVertexCount + job_size - 1) / job_size;
+
+		std::vector<SkinDeformJob> jobs(job_count);
+		for (int i = 0; i < job_count; ++i)
+		{
+			SkinDeformJob &job = jobs[i];
+			job.deformer = this;
+			job.skin = pSkin;
+			job.positions = pPositions;
+			job.normals = pNormals;
+			job.begin = i * job_size;
+			job.end = std::min(mVertexCount, job.begin + job_size);
+		}
+
+		RunJobs(SkinDeformJobFunc, jobs.data(), sizeof(SkinDeformJob), (u32)job_count, thread_count, processor, user_ptr);
+	}
+
+};
@@ -0,0 +1,98 @@
+#ifndef _OFBSKINNING_H_
+#define _OFBSKINNING_H_
+
+// OFBSkinning.h
+//
+// Sergei <Neill3d> Solokhin (https://github.com/Neill3d/OpenFBX)
+//
+
+#include <vector>
+#include "ofbx.h"
+
+namespace ofbx
+{
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// OFBSkinDeformer
+
+	// linear blend skinning of a mesh geometry
+	//  Init turns the skin clusters once into a fixed width table of (bone, weight) pairs per vertex,
+	//  Deform then walks the vertices in order, reading one table row and the few bone matrices it refers to
+	class OFBSkinDeformer
+	{
+	public:
+
+		enum { MAX_INFLUENCES = 8 };
+
+		//! a constructor
+		OFBSkinDeformer();
+
+		// build the influence table of the mesh geometry skin, max_influences is clamped to [1, MAX_INFLUENCES]
+		//  a vertex with more weights keeps the biggest ones, the weights of every vertex are normalized
+		//  returns false when the mesh has no skinned geometry
+		bool Init(const Mesh &mesh, int max_influences = 4);
+		void Clear();
+
+		int GetVertexCount() const {
+			return mVertexCount;
+		}
+		int GetInfluenceCount() const {
+			return mInfluences;
+		}
+		// one bone per skin cluster
+		int GetBoneCount() const {
+			return (int)mBones.size();
+		}
+		// cluster link, can be nullptr
+		const Model *GetBone(int index) const {
+			return mBones[index];
+		}
+
+		// GetVertexCount() * GetInfluenceCount() entries, every row sorted by weight with the biggest first,
+		//  unused slots at the end have bone 0 and weight 0
+		const int *GetBoneIndices() const {
+			return mIndices.empty() ? nullptr : mIndices.data();
+		}
+		const float *GetBoneWeights() const {
+			return mWeights.empty() ? nullptr : mWeights.data();
+		}
+
+		// skin matrices from GetBoneCount() bone global matrices and the mesh global matrix
+		//  skin = inverse(mesh global) * bone global * inverse(transform link) * transform,
+		//  so the deformed points stay in the space of Geometry::getVertices()
+		void ComputeSkinMatrices(OFBMatrix *pSkin, const OFBMatrix *pBoneGlobal, const OFBMatrix &meshGlobal) const;
+		// the same with the global matrices of an evaluated pose
+		//  bones missing from the pose stay at the bind pose, a missing mesh uses the identity
+		void ComputeSkinMatrices(OFBMatrix *pSkin, const ScenePose &pose) const;
+
+		// deform the geometry vertices and normals into pPositions and pNormals (GetVertexCount() items, either can be nullptr)
+		//  pNormals is left untouched when the geometry has no normals
+		//  vertex ranges are spread over thread_count threads (1 - the calling thread, 0 - every hardware thread) or the job processor
+		void Deform(const OFBMatrix *pSkin, OFBVector3 *pPositions, OFBVector3 *pNormals, int thread_count = 1, JobProcessor processor = nullptr, void *user_ptr = nullptr) const;
+
+		// deform the vertex range [begin, end), e.g. from a custom scheduler
+		void DeformRange(const OFBMatrix *pSkin, OFBVector3 *pPositions, OFBVector3 *pNormals, int begin, int end) const;
+
+	protected:
+
+		const Mesh					*mMesh;
+		// the geometry storage precision, the other pair is nullptr
+		const OFBVector3			*mVertices;
+		const OFBVector3			*mNormals;
+		const OFBVector3f			*mFloatVertices;
+		const OFBVector3f			*mFloatNormals;
+
+		int							mVertexCount;
+		int							mInfluences;
+
+		std::vector<const Model*>	mBones;
+		std::vector<OFBMatrix>		mLinkMatrices;	// transform link, bone global matrix at bind time
+		std::vector<OFBMatrix>		mBindMatrices;	// inverse(transform link) * transform
+
+		std::vector<int>			mIndices;
+		std::vector<float>			mWeights;
+	};
+
+};
+
+#endif
@@ -232,6 +232,18 @@ namespace ofbx
 		static const OFBTime OneHour;
 	};
 
+	// info for the one evaluation task
+	struct EvaluationInfo
+	{
+		OFBTime		localTime;
+		OFBTime		systemTime;
+
+		bool		IsStop;	// is playing or not
+	};
+
+	// global display time, the default of the property and model evaluation without a time
+	EvaluationInfo &GetDisplayInfo();
+
 };
 
 #endif
\ No newline at end of file
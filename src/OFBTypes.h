@@ -75,6 +75,47 @@ namespace ofbx
 		}
 	};
 
+	// single precision streams, LoadOptions::float_geometry
+
+	struct OFBVector2f
+	{
+		float x;
+		float y;
+	};
+
+	struct OFBVector3f
+	{
+		float x;
+		float y;
+		float z;
+
+		float &operator [] (int index)
+		{
+			return *(&x + index);
+		}
+		float operator [] (int index) const
+		{
+			return *(&x + index);
+		}
+	};
+
+	struct OFBVector4f
+	{
+		float x;
+		float y;
+		float z;
+		float w;
+
+		float &operator [] (int index)
+		{
+			return *(&x + index);
+		}
+		float operator [] (int index) const
+		{
+			return *(&x + index);
+		}
+	};
+
 	struct OFBColor
 	{
 		double r;
@@ -11,12 +11,32 @@
 #include <cassert>
 
 #include <ctype.h>
+#include <limits.h>
+#include <limits>
+#include <locale.h>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <algorithm>
+#include <chrono>
 
 #include "OFBMath.h"
+#include "OFBFile.h"
+
+// same compile time selection as the OFBMath kernels, OFBMATH_NO_SIMD forces the scalar code
+#if !defined(OFBMATH_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OFBX_TEXT_SSE2
+#include <emmintrin.h>
+#endif
+#endif
 
 #define _USE_MATH_DEFINES // for C++  
 #include <math.h> 
@@ -39,6 +59,8 @@ namespace ofbx
 		return gDisplayInfo;
 	}
 
+// the message is per thread, so independent loads can run in parallel,
+//  failures of the jobs on the worker threads are copied back to the loading thread
 struct Error
 {
 	Error() {}
@@ -46,11 +68,11 @@ struct Error
 		s_message = msg; 
 	}
 
-	static const char* s_message;
+	static thread_local const char* s_message;
 };
 
 
-const char* Error::s_message = "";
+thread_local const char* Error::s_message = "";
 
 
 template <typename T> struct OptionalError
@@ -109,11 +131,15 @@ struct Header
 #pragma pack()
 
 
+struct LoadProgress;
+
+
 struct Cursor
 {
 	const u8* current;
 	const u8* begin;
 	const u8* end;
+	LoadProgress* progress = nullptr;	// checked once per element by the tokenizers
 };
 
 
@@ -136,6 +162,376 @@ template <int SIZE> static bool copyString(char (&destination)[SIZE], const char
 }
 
 
+// bump allocator backing the Element/Property token tree of a scene
+//  every node is a pointer bump inside a page, the whole tree is released at once with the allocator
+struct Allocator
+{
+	struct Page
+	{
+		Page* next;
+		size_t size;
+		size_t used;
+	};
+
+	Allocator() {}
+	~Allocator() { release(); }
+
+	// size of the next pages, usually derived from the source file length
+	void setPageSize(size_t page_size) { m_page_size = page_size; }
+
+	template <typename T> T* allocate()
+	{
+		void* mem = allocate(sizeof(T), alignof(T));
+		return mem ? new (mem) T() : nullptr;
+	}
+
+	// nullptr when the system is out of memory
+	void* allocate(size_t size, size_t align)
+	{
+		size_t offset = m_page ? ((m_page->used + align - 1) & ~(align - 1)) : 0;
+		if (!m_page || offset + size > m_page->size)
+		{
+			if (size > SIZE_MAX - sizeof(Page) - align) return nullptr;
+			if (!addPage(size + align)) return nullptr;
+			offset = (m_page->used + align - 1) & ~(align - 1);
+		}
+		m_page->used = offset + size;
+		return (u8*)(m_page + 1) + offset;
+	}
+
+	// rewind without returning the memory to the system
+	void reset()
+	{
+		for (Page* page = m_first; page; page = page->next) page->used = 0;
+		m_page = m_first;
+	}
+
+	void getUsage(u64* reserved, u64* used) const
+	{
+		*reserved = 0;
+		*used = 0;
+		for (const Page* page = m_first; page; page = page->next)
+		{
+			*reserved += page->size;
+			*used += page->used;
+		}
+	}
+
+	void release()
+	{
+		Page* page = m_first;
+		while (page)
+		{
+			Page* next = page->next;
+			free(page);
+			page = next;
+		}
+		m_first = nullptr;
+		m_page = nullptr;
+	}
+
+private:
+	bool addPage(size_t min_size)
+	{
+		if (m_page && m_page->next && m_page->next->size >= min_size)
+		{
+			m_page = m_page->next;
+			m_page->used = 0;
+			return true;
+		}
+
+		size_t size = min_size > m_page_size ? min_size : m_page_size;
+		Page* page = (Page*)malloc(sizeof(Page) + size);
+		if (!page) return false;
+		page->size = size;
+		page->used = 0;
+		if (m_page)
+		{
+			// keep the rest of the chain when the allocator has been reset
+			page->next = m_page->next;
+			m_page->next = page;
+		}
+		else
+		{
+			page->next = nullptr;
+			m_first = page;
+		}
+		m_page = page;
+		return true;
+	}
+
+	Page* m_first = nullptr;
+	Page* m_page = nullptr;
+	size_t m_page_size = 64 * 1024;
+};
+
+
+static bool isTextSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+
+static bool isTextDigit(char c)
+{
+	return (u8)(c - '0') < 10;
+}
+
+
+// locale independent text number parsing, every parser stops right after the number
+template <typename T> static const char* parseTextInteger(const char* str, const char* end, T* val)
+{
+	while (str < end && isTextSpace(*str)) ++str;
+
+	bool negative = false;
+	if (str < end && (*str == '-' || *str == '+'))
+	{
+		negative = *str == '-';
+		++str;
+	}
+
+	// too long numbers saturate like strtoll, the remaining digits are still consumed
+	u64 value = 0;
+	while (str < end && isTextDigit(*str))
+	{
+		const u64 digit = u64(*str - '0');
+		value = value > (UINT64_MAX - digit) / 10 ? UINT64_MAX : value * 10 + digit;
+		++str;
+	}
+
+	if (std::is_signed<T>::value)
+	{
+		const u64 limit = (u64)std::numeric_limits<T>::max() + (negative ? 1 : 0);
+		if (value > limit) value = limit;
+		// negated in i64 without overflowing on the minimum, the result is in the range of T
+		*val = T(negative && value > 0 ? -i64(value - 1) - 1 : i64(value));
+	}
+	else
+	{
+		// unsigned values wrap a minus sign around like strtoull
+		const u64 limit = (u64)std::numeric_limits<T>::max();
+		if (value > limit) value = limit;
+		*val = T(negative ? limit - value + 1 : value);
+	}
+	return str;
+}
+
+
+// anything the fast path can't convert exactly, strtod on a copy with the locale decimal point
+static const char* parseTextDoubleSlow(const char* str, const char* end, double* val)
+{
+	size_t length = 0;
+	while (str + length < end)
+	{
+		const char c = str[length];
+		if (isTextSpace(c) || c == ',' || c == '}') break;
+		++length;
+	}
+
+	char small[64];
+	std::vector<char> big;
+	char* tmp = small;
+	if (length >= sizeof(small))
+	{
+		big.resize(length + 1);
+		tmp = &big[0];
+	}
+
+	const char decimal_point = *localeconv()->decimal_point;
+	for (size_t i = 0; i < length; ++i)
+	{
+		tmp[i] = str[i] == '.' ? decimal_point : str[i];
+	}
+	tmp[length] = '\0';
+
+	char* tmp_end = tmp;
+	*val = strtod(tmp, &tmp_end);
+	return str + (tmp_end - tmp);
+}
+
+
+// decimal values with up to 19 significant digits, mantissa below 2^53 and |exponent| <= 22 are
+//  exactly one correctly rounded multiplication or division (Clinger's fast path), that's every value
+//  the FBX SDK writes in %.15g or shorter
+static const char* parseTextDouble(const char* str, const char* end, double* val)
+{
+	static const double powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+	while (str < end && isTextSpace(*str)) ++str;
+	const char* begin = str;
+
+	bool negative = false;
+	if (str < end && (*str == '-' || *str == '+'))
+	{
+		negative = *str == '-';
+		++str;
+	}
+
+	u64 mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool truncated = false;
+	bool any_digit = false;
+	while (str < end && isTextDigit(*str))
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + u64(*str - '0');
+			if (mantissa != 0) ++digits;
+		}
+		else
+		{
+			truncated |= *str != '0';
+			++exponent;
+		}
+		any_digit = true;
+		++str;
+	}
+	if (str < end && *str == '.')
+	{
+		++str;
+		while (str < end && isTextDigit(*str))
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + u64(*str - '0');
+				if (mantissa != 0) ++digits;
+				--exponent;
+			}
+			else
+			{
+				truncated |= *str != '0';
+			}
+			any_digit = true;
+			++str;
+		}
+	}
+	// inf, nan, 1.#IND, ...
+	if (!any_digit) return parseTextDoubleSlow(begin, end, val);
+
+	if (str < end && (*str == 'e' || *str == 'E'))
+	{
+		const char* iter = str + 1;
+		bool negative_exponent = false;
+		if (iter < end && (*iter == '-' || *iter == '+'))
+		{
+			negative_exponent = *iter == '-';
+			++iter;
+		}
+		if (iter < end && isTextDigit(*iter))
+		{
+			int value = 0;
+			while (iter < end && isTextDigit(*iter))
+			{
+				if (value < 10000) value = value * 10 + (*iter - '0');
+				++iter;
+			}
+			exponent += negative_exponent ? -value : value;
+			str = iter;
+		}
+	}
+
+	if (mantissa == 0)
+	{
+		*val = negative ? -0.0 : 0.0;
+		return str;
+	}
+	if (truncated || mantissa > (u64(1) << 53) || exponent < -22 || exponent > 22)
+	{
+		return parseTextDoubleSlow(begin, end, val);
+	}
+
+	double value = (double)mantissa;
+	if (exponent < 0) value /= powers_of_ten[-exponent];
+	else value *= powers_of_ten[exponent];
+	*val = negative ? -value : value;
+	return str;
+}
+
+
+// wall clock of LoadStats, milliseconds
+static double getStatsTime()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// adds the time since the previous mark to a phase, does nothing without LoadOptions::stats
+struct PhaseTimer
+{
+	explicit PhaseTimer(LoadStats* _stats)
+		: stats(_stats)
+		, mark(_stats ? getStatsTime() : 0.0)
+	{
+	}
+
+	void end(LoadStats::Phase phase)
+	{
+		if (!stats) return;
+		const double now = getStatsTime();
+		stats->phase_time[phase] += now - mark;
+		mark = now;
+	}
+
+	LoadStats* stats;
+	double mark;
+};
+
+
+// LoadOptions::progress, every phase maps its own [0, 1] into the [from, to] range of the whole load
+struct LoadProgress
+{
+	// fractions of the whole load at the end of each phase
+	static constexpr float TOKENIZE = 0.3f;
+	static constexpr float INFLATE = 0.5f;
+	static constexpr float OBJECTS = 0.9f;
+	// tokenizers report once this many bytes of the source are read
+	static const size_t REPORT_BYTES = 256 * 1024;
+
+	void init(const LoadOptions& options)
+	{
+		callback = options.progress;
+		user_ptr = options.progress_user_ptr;
+	}
+
+	void setPhase(float _from, float _to)
+	{
+		from = _from;
+		to = _to;
+		next = 0;
+	}
+
+	// the phase fraction, false once the load is cancelled
+	bool report(float fraction)
+	{
+		if (is_cancelled) return false;
+		if (!callback) return true;
+		if (callback(from + (to - from) * fraction, user_ptr)) return true;
+
+		is_cancelled = true;
+		Error::s_message = "Load cancelled";
+		return false;
+	}
+
+	// tokenizer offset in a source of size bytes (0 - unknown), the callback runs every REPORT_BYTES
+	bool update(u64 offset, u64 size)
+	{
+		if (offset < next) return true;
+		next = offset + REPORT_BYTES;
+		return report(size > 0 ? float(offset) / float(size) : 0.0f);
+	}
+
+	bool (*callback)(float, void*) = nullptr;
+	void* user_ptr = nullptr;
+	float from = 0.0f;
+	float to = 1.0f;
+	u64 next = 0;
+	bool is_cancelled = false;
+};
+
+
 u64 DataView::toU64() const
 {
 	if (is_binary)
@@ -143,7 +539,9 @@ u64 DataView::toU64() const
 		assert(end - begin == sizeof(u64));
 		return *(u64*)begin;
 	}
-	return atoll((const char*)begin);
+	u64 value;
+	parseTextInteger((const char*)begin, (const char*)end, &value);
+	return value;
 }
 
 
@@ -154,7 +552,9 @@ int DataView::toInt() const
 		assert(end - begin == sizeof(int));
 		return *(int*)begin;
 	}
-	return atoi((const char*)begin);
+	int value;
+	parseTextInteger((const char*)begin, (const char*)end, &value);
+	return value;
 }
 
 
@@ -165,7 +565,9 @@ u32 DataView::toU32() const
 		assert(end - begin == sizeof(u32));
 		return *(u32*)begin;
 	}
-	return (u32)atoll((const char*)begin);
+	u32 value;
+	parseTextInteger((const char*)begin, (const char*)end, &value);
+	return value;
 }
 
 
@@ -176,7 +578,9 @@ double DataView::toDouble() const
 		assert(end - begin == sizeof(double));
 		return *(double*)begin;
 	}
-	return atof((const char*)begin);
+	double value;
+	parseTextDouble((const char*)begin, (const char*)end, &value);
+	return value;
 }
 
 
@@ -187,7 +591,9 @@ float DataView::toFloat() const
 		assert(end - begin == sizeof(float));
 		return *(float*)begin;
 	}
-	return (float)atof((const char*)begin);
+	double value;
+	parseTextDouble((const char*)begin, (const char*)end, &value);
+	return (float)value;
 }
 
 
@@ -205,6 +611,25 @@ bool DataView::operator==(const char* rhs) const
 }
 
 
+// 32-bit FNV-1a, used to pre-hash names for the lookups, the same hash as PropertyList::HashName
+static u32 hashName(const u8* begin, const u8* end)
+{
+	return PropertyList::HashName((const char*)begin, end - begin);
+}
+
+
+static u32 hashName(const char* name)
+{
+	u32 hash = 2166136261u;
+	for (const char* c = name; *c; ++c)
+	{
+		hash ^= (u8)*c;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
 struct Property;
 template <typename T> static bool parseArrayRaw(const Property& property, T* out, int max_size);
 template <typename T> static bool parseBinaryArray(const Property& property, std::vector<T>* out);
@@ -212,7 +637,6 @@ template <typename T> static bool parseBinaryArray(const Property& property, std
 
 struct Property : IElementProperty
 {
-	~Property() { delete next; }
 	Type getType() const override { return (Type)type; }
 	IElementProperty* getNext() const override { return next; }
 	DataView getValue() const override { return value; }
@@ -240,6 +664,7 @@ struct Property : IElementProperty
 	u8 type;
 	DataView value;
 	Property* next = nullptr;
+	const u8* inflated = nullptr;	// decoded content of a compressed array while parseObjects() runs, see inflateArrays()
 };
 
 
@@ -267,6 +692,170 @@ struct Element : IElement
 };
 
 
+////////////////////////////////////////////////////////////////////////////////////////
+// SceneCache
+
+// decoded geometry and animation curve arrays of a scene, written by IScene::SaveCache()
+//  the file is mapped, the entry table is sorted by object id and searched in place
+struct SceneCache
+{
+	enum { VERSION = 1, MAX_STREAMS = 10 };
+
+	// load options that change the decoded arrays
+	enum Flags
+	{
+		WELD_VERTICES = 1 << 0,
+		FLOAT_GEOMETRY = 1 << 1
+	};
+
+	// stream order of the entries
+	enum GeometryStream
+	{
+		GEOMETRY_VERTICES,
+		GEOMETRY_NORMALS,
+		GEOMETRY_UVS,
+		GEOMETRY_COLORS,
+		GEOMETRY_TANGENTS,
+		GEOMETRY_MATERIALS,
+		GEOMETRY_TO_OLD_VERTICES,
+		GEOMETRY_TO_NEW_OFFSETS,
+		GEOMETRY_TO_NEW_INDICES,
+		GEOMETRY_INDICES,
+		GEOMETRY_STREAM_COUNT
+	};
+
+	enum CurveStream
+	{
+		CURVE_TIMES,
+		CURVE_VALUES,
+		CURVE_FLAGS,
+		CURVE_STREAM_COUNT
+	};
+
+	struct FileHeader
+	{
+		char magic[8];
+		u32 version;
+		u32 flags;
+		u64 source_hash;
+		u64 source_size;
+		u64 entry_count;
+	};
+
+	struct Stream
+	{
+		u64 offset;	// from the file start
+		u64 size;	// in bytes
+	};
+
+	struct Entry
+	{
+		u64 id;
+		u32 type;	// Object::Type
+		u32 stream_count;
+		Stream streams[MAX_STREAMS];
+	};
+
+	static const char* magic() { return "OFBXCCH"; }
+
+	static u32 getFlags(const LoadOptions& options)
+	{
+		return (options.weld_vertices ? WELD_VERTICES : 0) | (options.float_geometry ? FLOAT_GEOMETRY : 0);
+	}
+
+	// 64-bit hash of the source, eight bytes per step
+	static u64 hashSource(const u8* data, size_t size)
+	{
+		u64 hash = 0x9E3779B97F4A7C15ull ^ size;
+		const u8* iter = data;
+		for (const u8* end = data + (size & ~(size_t)7); iter < end; iter += 8)
+		{
+			u64 word;
+			memcpy(&word, iter, sizeof(word));
+			hash ^= word * 0x87C37B91114253D5ull;
+			hash = ((hash << 31) | (hash >> 33)) * 0x4CF5AD432745937Full;
+		}
+		for (const u8* end = data + size; iter < end; ++iter)
+		{
+			hash ^= *iter;
+			hash *= 0x100000001B3ull;
+		}
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	// false when the file is missing or was written for another source, version or load options
+	bool open(const char* path, u64 source_hash, u64 source_size, u32 flags)
+	{
+		if (!file.Open(path)) return false;
+
+		FileHeader header;
+		const u64 size = file.GetSize();
+		if (size < sizeof(header)) return close();
+		memcpy(&header, file.GetData(), sizeof(header));
+
+		if (memcmp(header.magic, magic(), sizeof(header.magic)) != 0) return close();
+		if (header.version != VERSION || header.flags != flags) return close();
+		if (header.source_hash != source_hash || header.source_size != source_size) return close();
+		if (header.entry_count > (size - sizeof(header)) / sizeof(Entry)) return close();
+
+		const Entry* table = (const Entry*)(file.GetData() + sizeof(header));
+		for (u64 i = 0; i < header.entry_count; ++i)
+		{
+			const Entry& entry = table[i];
+			if (entry.stream_count > MAX_STREAMS) return close();
+			if (i > 0 && table[i - 1].id >= entry.id) return close();
+			for (u32 j = 0; j < entry.stream_count; ++j)
+			{
+				const Stream& stream = entry.streams[j];
+				if (stream.offset > size || stream.size > size - stream.offset) return close();
+			}
+		}
+
+		entries = table;
+		entry_count = header.entry_count;
+		return true;
+	}
+
+	bool close()
+	{
+		file.Close();
+		entries = nullptr;
+		entry_count = 0;
+		return false;
+	}
+
+	const Entry* find(u64 id, Object::Type type) const
+	{
+		if (!entries) return nullptr;
+
+		const Entry* end = entries + entry_count;
+		const Entry* iter = std::lower_bound(entries, end, id, [](const Entry& entry, u64 value) { return entry.id < value; });
+		if (iter == end || iter->id != id || iter->type != (u32)type) return nullptr;
+		return iter;
+	}
+
+	// element size check of a stream, so all the streams of an entry can be validated before any is read
+	static bool fits(const Entry& entry, int stream, size_t elem_size)
+	{
+		return stream < (int)entry.stream_count && entry.streams[stream].size % elem_size == 0;
+	}
+
+	template <typename T> void read(const Entry& entry, int stream, std::vector<T>* out) const
+	{
+		const Stream& src = entry.streams[stream];
+		out->resize((size_t)(src.size / sizeof(T)));
+		if (!out->empty()) memcpy(&(*out)[0], file.GetData() + src.offset, (size_t)src.size);
+	}
+
+	OFBMappedFile file;
+	const Entry* entries = nullptr;
+	u64 entry_count = 0;
+};
+
+
 static const Element* findChild(const Element& element, const char* id)
 {
 	Element* const* iter = &element.child;
@@ -504,30 +1093,146 @@ ModelSkeleton::ModelSkeleton(const Scene& _scene, const IElement& _element)
 : Model(_scene, _element)
 {}
 
-static bool decompress(const u8* in, size_t in_size, u8* out, size_t out_size)
+// scratch state of the parse functions, nothing is allocated once the buffers have grown
+//  each scratch vector has a single user, so the parse functions using them can nest
+struct ParseContext
+{
+	tinfl_decompressor inflator;			// decompress()
+	std::vector<float> floats;				// parseDoubleVecData() conversion
+	std::vector<OFBVector3> vertices;		// decodeGeometry() control points
+	std::vector<int> polygon_indices;		// decodeGeometry() source polygons
+	std::vector<int> to_old_indices;		// decodeGeometry() triangulation
+	std::vector<int> layer_indices;			// decodeGeometry() materials and layer indices
+	std::vector<int> cluster_indices;		// ClusterImpl::postprocess()
+	std::vector<double> cluster_weights;	// ClusterImpl::postprocess()
+	int depth = 0;							// open ParseScope count
+
+	// drop the buffers, the inflator holds no allocation
+	void release()
+	{
+		std::vector<float>().swap(floats);
+		std::vector<OFBVector3>().swap(vertices);
+		std::vector<int>().swap(polygon_indices);
+		std::vector<int>().swap(to_old_indices);
+		std::vector<int>().swap(layer_indices);
+		std::vector<int>().swap(cluster_indices);
+		std::vector<double>().swap(cluster_weights);
+	}
+};
+
+
+// contexts of the parallel load phases, a job borrows a free one, so the buffers grown by a job are reused
+//  by the next ones whatever thread runs them, built-in or of a job processor. they are dropped with the pool
+struct ParseContextPool
 {
-	mz_stream stream = {};
-	mz_inflateInit(&stream);
+	ParseContext* acquire()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (free.empty())
+		{
+			contexts.push_back(std::make_unique<ParseContext>());
+			return contexts.back().get();
+		}
+		ParseContext* context = free.back();
+		free.pop_back();
+		return context;
+	}
 
-	stream.avail_in = (int)in_size;
-	stream.next_in = in;
-	stream.avail_out = (int)out_size;
-	stream.next_out = out;
+	void giveBack(ParseContext* context)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		free.push_back(context);
+	}
+
+	// once the jobs of the phases are done
+	void release()
+	{
+		free.clear();
+		contexts.clear();
+	}
 
-	int status = mz_inflate(&stream, Z_SYNC_FLUSH);
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ParseContext>> contexts;
+	std::vector<ParseContext*> free;
+};
 
-	if (status != Z_STREAM_END) return false;
 
-	return mz_inflateEnd(&stream) == Z_OK;
-}
+static thread_local ParseContext* s_pooled_context = nullptr;	// context of the running PooledParseScope
 
 
-template <typename T> static OptionalError<T> read(Cursor* cursor)
+static ParseContext& getParseContext()
 {
-	if (cursor->current + sizeof(T) > cursor->end) return Error("Reading past the end");
-	T value = *(const T*)cursor->current;
-	cursor->current += sizeof(T);
-	return value;
+	if (s_pooled_context) return *s_pooled_context;
+	static thread_local ParseContext context;
+	return context;
+}
+
+
+// outermost user of the thread context drops the buffers when done, so a thread which outlives the load
+//  (caller of a lazy decode) doesn't keep them, nested scopes and the scopes inside a load job keep them
+struct ParseScope
+{
+	ParseScope()
+		: context(getParseContext())
+	{
+		++context.depth;
+	}
+
+	~ParseScope()
+	{
+		if (--context.depth == 0) context.release();
+	}
+
+	ParseContext& context;
+};
+
+
+// one job of a parallel load phase, the thread uses a context of the pool until the job is done
+struct PooledParseScope
+{
+	explicit PooledParseScope(ParseContextPool& _pool)
+		: pool(_pool)
+		, context(_pool.acquire())
+		, previous(s_pooled_context)
+	{
+		s_pooled_context = context;
+		++context->depth;
+	}
+
+	~PooledParseScope()
+	{
+		--context->depth;
+		s_pooled_context = previous;
+		pool.giveBack(context);
+	}
+
+	ParseContextPool& pool;
+	ParseContext* context;
+	ParseContext* previous;
+};
+
+
+// the whole output is known, so the inflator writes straight into it and needs no dictionary
+static bool decompress(const u8* in, size_t in_size, u8* out, size_t out_size)
+{
+	tinfl_decompressor* inflator = &getParseContext().inflator;
+	tinfl_init(inflator);
+
+	size_t in_bytes = in_size;
+	size_t out_bytes = out_size;
+	const tinfl_status status = tinfl_decompress(inflator, in, &in_bytes, out, out, &out_bytes,
+		TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF | TINFL_FLAG_COMPUTE_ADLER32);
+
+	return status == TINFL_STATUS_DONE;
+}
+
+
+template <typename T> static OptionalError<T> read(Cursor* cursor)
+{
+	if (cursor->current + sizeof(T) > cursor->end) return Error("Reading past the end");
+	T value = *(const T*)cursor->current;
+	cursor->current += sizeof(T);
+	return value;
 }
 
 
@@ -563,11 +1268,12 @@ static OptionalError<DataView> readLongString(Cursor* cursor)
 }
 
 
-static OptionalError<Property*> readProperty(Cursor* cursor)
+static OptionalError<Property*> readProperty(Cursor* cursor, Allocator& allocator)
 {
 	if (cursor->current == cursor->end) return Error("Reading past the end");
 
-	std::unique_ptr<Property> prop = std::make_unique<Property>();
+	Property* prop = allocator.allocate<Property>();
+	if (!prop) return Error("Out of memory");
 	prop->next = nullptr;
 	prop->type = *cursor->current;
 	++cursor->current;
@@ -614,24 +1320,7 @@ static OptionalError<Property*> readProperty(Cursor* cursor)
 		default: return Error("Unknown property type");
 	}
 	prop->value.end = cursor->current;
-	return prop.release();
-}
-
-
-static void deleteElement(Element* el)
-{
-	if (!el) return;
-
-	delete el->first_property;
-	deleteElement(el->child);
-	Element* iter = el;
-	// do not use recursion to avoid stack overflow
-	do
-	{
-		Element* next = iter->sibling;
-		delete iter;
-		iter = next;
-	} while (iter);
+	return prop;
 }
 
 
@@ -650,8 +1339,10 @@ static OptionalError<u64> readElementOffset(Cursor* cursor, u16 version)
 }
 
 
-static OptionalError<Element*> readElement(Cursor* cursor, u32 version)
+static OptionalError<Element*> readElement(Cursor* cursor, u32 version, Allocator& allocator)
 {
+	if (cursor->progress && !cursor->progress->update(cursor->current - cursor->begin, cursor->end - cursor->begin)) return Error();
+
 	OptionalError<u64> end_offset = readElementOffset(cursor, version);
 	if (end_offset.isError()) return Error();
 	if (end_offset.getValue() == 0) return nullptr;
@@ -665,7 +1356,8 @@ static OptionalError<Element*> readElement(Cursor* cursor, u32 version)
 	OptionalError<DataView> id = readShortString(cursor);
 	if (id.isError()) return Error();
 
-	Element* element = new Element();
+	Element* element = allocator.allocate<Element>();
+	if (!element) return Error("Out of memory");
 	element->first_property = nullptr;
 	element->id = id.getValue();
 
@@ -675,12 +1367,8 @@ static OptionalError<Element*> readElement(Cursor* cursor, u32 version)
 	Property** prop_link = &element->first_property;
 	for (u32 i = 0; i < prop_count.getValue(); ++i)
 	{
-		OptionalError<Property*> prop = readProperty(cursor);
-		if (prop.isError())
-		{
-			deleteElement(element);
-			return Error();
-		}
+		OptionalError<Property*> prop = readProperty(cursor, allocator);
+		if (prop.isError()) return Error();
 
 		*prop_link = prop.getValue();
 		prop_link = &(*prop_link)->next;
@@ -693,13 +1381,8 @@ static OptionalError<Element*> readElement(Cursor* cursor, u32 version)
 	Element** link = &element->child;
 	while (cursor->current - cursor->begin < ((ptrdiff_t)end_offset.getValue() - BLOCK_SENTINEL_LENGTH))
 	{
-		OptionalError<Element*> child = readElement(cursor, version);
-
-		if (child.isError())
-		{
-			deleteElement(element);
-			return Error();
-		}
+		OptionalError<Element*> child = readElement(cursor, version, allocator);
+		if (child.isError()) return Error();
 
 		if (nullptr != child.getValue())
 		{
@@ -708,11 +1391,7 @@ static OptionalError<Element*> readElement(Cursor* cursor, u32 version)
 		}
 	}
 
-	if (cursor->current + BLOCK_SENTINEL_LENGTH > cursor->end)
-	{
-		deleteElement(element); 
-		return Error("Reading past the end");
-	}
+	if (cursor->current + BLOCK_SENTINEL_LENGTH > cursor->end) return Error("Reading past the end");
 
 	cursor->current += BLOCK_SENTINEL_LENGTH;
 	return element;
@@ -774,9 +1453,72 @@ static DataView readTextToken(Cursor* cursor)
 }
 
 
-static OptionalError<Property*> readTextProperty(Cursor* cursor)
+static int countBits(u32 value)
+{
+	value = value - ((value >> 1) & 0x55555555);
+	value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+	return int((((value + (value >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+}
+
+
+// count the values of a text array up to the closing '}', is_real is set when any value has a fraction or an exponent
+//  the values are comma separated numbers, so the count is the number of the commas plus the last value
+static const u8* scanTextArray(const u8* begin, const u8* end, int* count, bool* is_real)
+{
+	const u8* iter = begin;
+	int commas = 0;
+	bool real = false;
+
+#ifdef OFBX_TEXT_SSE2
+	const __m128i comma = _mm_set1_epi8(',');
+	const __m128i brace = _mm_set1_epi8('}');
+	const __m128i dot = _mm_set1_epi8('.');
+	const __m128i exp_lower = _mm_set1_epi8('e');
+	const __m128i exp_upper = _mm_set1_epi8('E');
+	while (end - iter >= 16)
+	{
+		const __m128i chars = _mm_loadu_si128((const __m128i*)iter);
+		const __m128i real_chars = _mm_or_si128(_mm_cmpeq_epi8(chars, dot), _mm_or_si128(_mm_cmpeq_epi8(chars, exp_lower), _mm_cmpeq_epi8(chars, exp_upper)));
+		const u32 brace_mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, brace));
+		u32 comma_mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, comma));
+		u32 real_mask = (u32)_mm_movemask_epi8(real_chars);
+		if (brace_mask != 0)
+		{
+			// only the chars in front of the brace
+			const u32 before = (brace_mask & (0 - brace_mask)) - 1;
+			commas += countBits(comma_mask & before);
+			real |= (real_mask & before) != 0;
+			iter += countBits(before);
+			break;
+		}
+		commas += countBits(comma_mask);
+		real |= real_mask != 0;
+		iter += 16;
+	}
+#endif
+
+	while (iter < end && *iter != '}')
+	{
+		if (*iter == ',') ++commas;
+		else if (*iter == '.' || *iter == 'e' || *iter == 'E') real = true;
+		++iter;
+	}
+
+	// the last value has no comma after it, "a: " is an empty array
+	const u8* last = iter;
+	while (last > begin && isTextSpace(last[-1])) --last;
+	const bool is_last = last > begin && last[-1] != ',';
+
+	*count = commas + (is_last ? 1 : 0);
+	*is_real = real;
+	return iter;
+}
+
+
+static OptionalError<Property*> readTextProperty(Cursor* cursor, Allocator& allocator)
 {
-	std::unique_ptr<Property> prop = std::make_unique<Property>();
+	Property* prop = allocator.allocate<Property>();
+	if (!prop) return Error("Out of memory");
 	prop->value.is_binary = false;
 	prop->next = nullptr;
 	if (*cursor->current == '"')
@@ -790,7 +1532,7 @@ static OptionalError<Property*> readTextProperty(Cursor* cursor)
 		}
 		prop->value.end = cursor->current;
 		if (cursor->current < cursor->end) ++cursor->current; // skip '"'
-		return prop.release();
+		return prop;
 	}
 	
 	if (isdigit(*cursor->current) || *cursor->current == '-')
@@ -823,7 +1565,7 @@ static OptionalError<Property*> readTextProperty(Cursor* cursor)
 
 			prop->value.end = cursor->current;
 		}
-		return prop.release();
+		return prop;
 	}
 	
 	if (*cursor->current == 'T' || *cursor->current == 'Y')
@@ -833,7 +1575,7 @@ static OptionalError<Property*> readTextProperty(Cursor* cursor)
 		prop->value.begin = cursor->current;
 		++cursor->current;
 		prop->value.end = cursor->current;
-		return prop.release();
+		return prop;
 	}
 
 	if (*cursor->current == '*')
@@ -848,23 +1590,12 @@ static OptionalError<Property*> readTextProperty(Cursor* cursor)
 		if (cursor->current < cursor->end) ++cursor->current; // skip ':'
 		skipInsignificantWhitespaces(cursor);
 		prop->value.begin = cursor->current;
-		prop->count = 0;
-		bool is_any = false;
-		while (cursor->current < cursor->end && *cursor->current != '}')
-		{
-			if (*cursor->current == ',')
-			{
-				if (is_any) ++prop->count;
-				is_any = false;
-			}
-			else if (!isspace(*cursor->current) && *cursor->current != '\n') is_any = true;
-			if (*cursor->current == '.') prop->type = 'd';
-			++cursor->current;
-		}
-		if (is_any) ++prop->count;
+		bool is_real = false;
+		cursor->current = scanTextArray(cursor->current, cursor->end, &prop->count, &is_real);
+		if (is_real) prop->type = 'd';
 		prop->value.end = cursor->current;
 		if (cursor->current < cursor->end) ++cursor->current; // skip '}'
-		return prop.release();
+		return prop;
 	}
 
 	assert(false);
@@ -872,8 +1603,10 @@ static OptionalError<Property*> readTextProperty(Cursor* cursor)
 }
 
 
-static OptionalError<Element*> readTextElement(Cursor* cursor)
+static OptionalError<Element*> readTextElement(Cursor* cursor, Allocator& allocator)
 {
+	if (cursor->progress && !cursor->progress->update(cursor->current - cursor->begin, cursor->end - cursor->begin)) return Error();
+
 	DataView id = readTextToken(cursor);
 	if (cursor->current == cursor->end) return Error("Unexpected end of file");
 	if(*cursor->current != ':') return Error("Unexpected end of file");
@@ -882,18 +1615,15 @@ static OptionalError<Element*> readTextElement(Cursor* cursor)
 	skipWhitespaces(cursor);
 	if (cursor->current == cursor->end) return Error("Unexpected end of file");
 
-	Element* element = new Element;
+	Element* element = allocator.allocate<Element>();
+	if (!element) return Error("Out of memory");
 	element->id = id;
 
 	Property** prop_link = &element->first_property;
 	while (cursor->current < cursor->end && *cursor->current != '\n' && *cursor->current != '{')
 	{
-		OptionalError<Property*> prop = readTextProperty(cursor);
-		if (prop.isError())
-		{
-			deleteElement(element);
-			return Error();
-		}
+		OptionalError<Property*> prop = readTextProperty(cursor, allocator);
+		if (prop.isError()) return Error();
 		if (cursor->current < cursor->end && *cursor->current == ',')
 		{
 			++cursor->current;
@@ -912,12 +1642,8 @@ static OptionalError<Element*> readTextElement(Cursor* cursor)
 		skipWhitespaces(cursor);
 		while (cursor->current < cursor->end && *cursor->current != '}')
 		{
-			OptionalError<Element*> child = readTextElement(cursor);
-			if (child.isError())
-			{
-				deleteElement(element);
-				return Error();
-			}
+			OptionalError<Element*> child = readTextElement(cursor, allocator);
+			if (child.isError()) return Error();
 			skipWhitespaces(cursor);
 
 			*link = child.getValue();
@@ -929,14 +1655,16 @@ static OptionalError<Element*> readTextElement(Cursor* cursor)
 }
 
 
-static OptionalError<Element*> tokenizeText(const u8* data, size_t size)
+static OptionalError<Element*> tokenizeText(const u8* data, size_t size, Allocator& allocator, LoadProgress* progress)
 {
 	Cursor cursor;
 	cursor.begin = data;
 	cursor.current = data;
 	cursor.end = data + size;
+	cursor.progress = progress;
 
-	Element* root = new Element();
+	Element* root = allocator.allocate<Element>();
+	if (!root) return Error("Out of memory");
 	root->first_property = nullptr;
 	root->id.begin = nullptr;
 	root->id.end = nullptr;
@@ -952,12 +1680,8 @@ static OptionalError<Element*> tokenizeText(const u8* data, size_t size)
 		}
 		else
 		{
-			OptionalError<Element*> child = readTextElement(&cursor);
-			if (child.isError())
-			{
-				deleteElement(root);
-				return Error();
-			}
+			OptionalError<Element*> child = readTextElement(&cursor, allocator);
+			if (child.isError()) return Error();
 			*element = child.getValue();
 			if (!*element) return root;
 			element = &(*element)->sibling;
@@ -968,17 +1692,19 @@ static OptionalError<Element*> tokenizeText(const u8* data, size_t size)
 }
 
 
-static OptionalError<Element*> tokenize(const u8* data, size_t size)
+static OptionalError<Element*> tokenize(const u8* data, size_t size, Allocator& allocator, LoadProgress* progress)
 {
 	Cursor cursor;
 	cursor.begin = data;
 	cursor.current = data;
 	cursor.end = data + size;
+	cursor.progress = progress;
 
 	const Header* header = (const Header*)cursor.current;
 	cursor.current += sizeof(*header);
 
-	Element* root = new Element();
+	Element* root = allocator.allocate<Element>();
+	if (!root) return Error("Out of memory");
 	root->first_property = nullptr;
 	root->id.begin = nullptr;
 	root->id.end = nullptr;
@@ -988,12 +1714,8 @@ static OptionalError<Element*> tokenize(const u8* data, size_t size)
 	Element** element = &root->child;
 	for (;;)
 	{
-		OptionalError<Element*> child = readElement(&cursor, header->version);
-		if (child.isError())
-		{
-			deleteElement(root);
-			return Error();
-		}
+		OptionalError<Element*> child = readElement(&cursor, header->version, allocator);
+		if (child.isError()) return Error();
 		*element = child.getValue();
 		if (!*element) return root;
 		element = &(*element)->sibling;
@@ -1447,6 +2169,29 @@ struct CameraImpl : Camera
 		return true;
 	}
 
+	bool GetCameraMatrix(float *pMatrix, CameraMatrixType pType, EvaluationContext &context) const override
+	{
+		double matrix[16];
+		if (!GetCameraMatrix(matrix, pType, context))
+			return false;
+
+		for (int i = 0; i < 16; ++i)
+			pMatrix[i] = (float)matrix[i];
+		return true;
+	}
+
+	bool GetCameraMatrix(double *pMatrix, CameraMatrixType pType, EvaluationContext &context) const override
+	{
+		OFBMatrix projection, modelview;
+		if (!ComputeCameraMatrix(projection, modelview, context.GetTime(), &context))
+			return false;
+
+		const OFBMatrix &src = (eProjection == pType) ? projection : modelview;
+		for (int i = 0; i < 16; ++i)
+			pMatrix[i] = src.m[i];
+		return true;
+	}
+
 	double ComputeFieldOfView(const double focal, const double h) const override
 	{
 		double fov = 2.0 * atan(h / 2.0 * focal);
@@ -1456,6 +2201,20 @@ struct CameraImpl : Camera
 	bool ComputeCameraMatrix(OFBTime *pTime = nullptr)
 	{
 		OFBTime lTime((nullptr != pTime) ? pTime->Get() : gDisplayInfo.localTime.Get());
+		return ComputeCameraMatrix(mProjection, mModelView, lTime, nullptr);
+	}
+
+	// with a context every value is evaluated at the context time and no object cache is written
+	bool ComputeCameraMatrix(OFBMatrix &projection, OFBMatrix &modelview, const OFBTime &lTime, EvaluationContext *context) const
+	{
+		auto getVector = [&lTime, context](const Model *pModel, OFBVector3 &v) {
+			if (context) pModel->GetVector(v, *context, eModelTranslation, true);
+			else pModel->GetVector(v, eModelTranslation, true, &lTime);
+		};
+		auto getData = [&lTime, context](const PropertyBase &prop, double *value) {
+			if (context) prop.GetData(value, sizeof(double), *context);
+			else prop.GetData(value, sizeof(double), &lTime);
+		};
 
 		// Compute the camera position and direction.
 		
@@ -1464,12 +2223,12 @@ struct CameraImpl : Camera
 		OFBVector3 lForward, lRight;
 
 		OFBVector3 lEye; // = Position;
-		GetVector(lEye, eModelTranslation, true, &lTime);
+		getVector(this, lEye);
 		OFBVector3 lUp = UpVector;
 
 		if (nullptr != GetTarget())
 		{
-			GetTarget()->GetVector(lCenter, eModelTranslation, true, pTime);
+			getVector(GetTarget(), lCenter);
 		}
 		else
 		{
@@ -1477,7 +2236,8 @@ struct CameraImpl : Camera
 			OFBMatrix lGlobalRotation;
 			OFBMatrix lGlobalTransform;
 
-			GetMatrix(lGlobalTransform, eModelTransformation, true, pTime);
+			if (context) GetMatrix(lGlobalTransform, *context, eModelTransformation, true);
+			else GetMatrix(lGlobalTransform, eModelTransformation, true, &lTime);
 			OFBVector4 lRotationVector = MatrixGetRotation(lGlobalTransform);
 			QuaternionToMatrix(lGlobalRotation, lRotationVector);
 			
@@ -1517,7 +2277,7 @@ struct CameraImpl : Camera
 		double lRadians = 0;
 		double lRoll = 0.0;
 		
-		Roll.GetData(&lRoll, sizeof(double), &lTime);
+		getData(Roll, &lRoll);
 
 		lRadians = lRoll * M_PI / 180.0; // FBXSDK_PI_DIV_180;
 		lUp = lUp * cos(lRadians) + lRight * sin(lRadians);
@@ -1626,21 +2386,21 @@ struct CameraImpl : Camera
 			switch (ApertureMode)
 			{
 			case eApertureVertical:
-				FieldOfView.GetData(&lFieldOfViewY, sizeof(double), &lTime);
+				getData(FieldOfView, &lFieldOfViewY);
 				lFieldOfViewX = VFOV2HFOV(lFieldOfViewY, 1.0 / lApertureRatio);
 				break;
 			case eApertureHorizontal:
-				FieldOfView.GetData(&lFieldOfViewX, sizeof(double), &lTime); //get HFOV
+				getData(FieldOfView, &lFieldOfViewX); //get HFOV
 				lFieldOfViewY = HFOV2VFOV(lFieldOfViewX, lApertureRatio);
 				break;
 			case eApertureFocalLength:
-				FocalLength.GetData(&lFocalLength, sizeof(double), &lTime);
+				getData(FocalLength, &lFocalLength);
 				lFieldOfViewX = ComputeFieldOfView(lFocalLength, lFilmWidth);    //get HFOV
 				lFieldOfViewY = HFOV2VFOV(lFieldOfViewX, lApertureRatio);
 				break;
 			case eApertureVertHoriz:
-				FieldOfViewX.GetData(&lFieldOfViewX, sizeof(double), &lTime);
-				FieldOfViewY.GetData(&lFieldOfViewY, sizeof(double), &lTime);
+				getData(FieldOfViewX, &lFieldOfViewX);
+				getData(FieldOfViewY, &lFieldOfViewY);
 			}
 
 
@@ -1666,12 +2426,12 @@ struct CameraImpl : Camera
 			}
 
 			//revise the Perspective since we have film offset
-			double lFilmOffsetX = FilmOffsetX.Get();
-			double lFilmOffsetY = FilmOffsetY.Get();
+			double lFilmOffsetX = FilmOffsetX;
+			double lFilmOffsetY = FilmOffsetY;
 			lFilmOffsetX = 0.0 - lFilmOffsetX / lFilmWidth * 2.0;
 			lFilmOffsetY = 0.0 - lFilmOffsetY / lFilmHeight * 2.0;
 
-			GetCameraPerspectiveMatrix(mProjection, mModelView, lFieldOfViewY, lAspectRatio, lNearPlane, lFarPlane, 
+			GetCameraPerspectiveMatrix(projection, modelview, lFieldOfViewY, lAspectRatio, lNearPlane, lFarPlane, 
 				lEye, lCenter, lUp, lFilmOffsetX, lFilmOffsetY);
 
 		}
@@ -1700,7 +2460,7 @@ struct CameraImpl : Camera
 				lTopPlane = gsOrthoCameraScale;
 			}
 
-			GetCameraOrthogonal(mProjection, mModelView, lLeftPlane,
+			GetCameraOrthogonal(projection, modelview, lLeftPlane,
 				lRightPlane,
 				lBottomPlane,
 				lTopPlane,
@@ -2011,6 +2771,201 @@ Geometry::Geometry(const Scene& _scene, const IElement& _element)
 }
 
 
+VertexLayout& VertexLayout::Add(OFBVertexAttribute attribute, OFBVertexFormat format, int components, int offset)
+{
+	assert(count < eVertexAttributeCount);
+	assert(attribute >= 0 && attribute < eVertexAttributeCount);
+	assert(components >= 1 && components <= 4);
+	if (count >= eVertexAttributeCount) return *this;
+	if (attribute < 0 || attribute >= eVertexAttributeCount) return *this;
+
+	Attribute& attr = attributes[count];
+	attr.attribute = attribute;
+	attr.format = format;
+	attr.components = components < 1 ? 1 : (components > 4 ? 4 : components);
+	attr.offset = offset < 0 ? GetSize() : (u32)offset;
+	++count;
+	return *this;
+}
+
+
+u32 VertexLayout::GetSize() const
+{
+	u32 size = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		const u32 end = attributes[i].offset + attributes[i].components * GetFormatSize(attributes[i].format);
+		if (end > size) size = end;
+	}
+	return size;
+}
+
+
+u32 VertexLayout::GetFormatSize(OFBVertexFormat format)
+{
+	switch (format)
+	{
+		case eVertexFloat32: return 4;
+		case eVertexFloat16:
+		case eVertexSNorm16:
+		case eVertexUNorm16: return 2;
+		case eVertexSNorm8:
+		case eVertexUNorm8: return 1;
+	}
+	return 0;
+}
+
+
+// IEEE half with round to nearest even, overflow goes to infinity
+static u16 floatToHalf(float value)
+{
+	u32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const u16 sign = (u16)((bits >> 16) & 0x8000);
+	const u32 abs = bits & 0x7FFFFFFF;
+
+	if (abs >= 0x7F800000) return sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 : 0); // inf or nan
+	if (abs >= 0x477FF000) return sign | 0x7C00; // rounds past 65504
+	if (abs < 0x33000000) return sign; // rounds to zero
+
+	u32 result;
+	u32 rem;
+	u32 halfway;
+	if (abs < 0x38800000)
+	{
+		// subnormal half
+		const u32 shift = 126 - (abs >> 23);
+		const u32 mantissa = (abs & 0x7FFFFF) | 0x800000;
+		result = mantissa >> shift;
+		rem = mantissa & ((1u << shift) - 1);
+		halfway = 1u << (shift - 1);
+	}
+	else
+	{
+		result = (abs >> 13) - (112 << 10);
+		rem = abs & 0x1FFF;
+		halfway = 0x1000;
+	}
+	if (rem > halfway || (rem == halfway && (result & 1))) ++result;
+	return sign | (u16)result;
+}
+
+
+static void writeComponent(u8* dst, OFBVertexFormat format, double value)
+{
+	switch (format)
+	{
+		case eVertexFloat32:
+		{
+			const float v = (float)value;
+			memcpy(dst, &v, sizeof(v));
+			break;
+		}
+		case eVertexFloat16:
+		{
+			const u16 v = floatToHalf((float)value);
+			memcpy(dst, &v, sizeof(v));
+			break;
+		}
+		case eVertexSNorm16:
+		{
+			const double c = value < -1.0 ? -1.0 : (value > 1.0 ? 1.0 : value);
+			const kShort v = (kShort)floor(c * 32767.0 + 0.5);
+			memcpy(dst, &v, sizeof(v));
+			break;
+		}
+		case eVertexUNorm16:
+		{
+			const double c = value < 0.0 ? 0.0 : (value > 1.0 ? 1.0 : value);
+			const u16 v = (u16)(c * 65535.0 + 0.5);
+			memcpy(dst, &v, sizeof(v));
+			break;
+		}
+		case eVertexSNorm8:
+		{
+			const double c = value < -1.0 ? -1.0 : (value > 1.0 ? 1.0 : value);
+			*(kByte*)dst = (kByte)floor(c * 127.0 + 0.5);
+			break;
+		}
+		case eVertexUNorm8:
+		{
+			const double c = value < 0.0 ? 0.0 : (value > 1.0 ? 1.0 : value);
+			*dst = (u8)(c * 255.0 + 0.5);
+			break;
+		}
+	}
+}
+
+
+int Geometry::WriteVertices(const VertexLayout& layout, void* dst, size_t stride) const
+{
+	const int vertex_count = getVertexCount();
+	if (!dst || vertex_count == 0 || layout.count == 0) return 0;
+	if (stride == 0) stride = layout.GetSize();
+
+	struct Source
+	{
+		const double* data;
+		const float* data_f;
+		int dims;
+		double defaults[4];
+	};
+
+	// the stored precision is read so no conversion is made, the vectors are laid out as 2/3/4 tightly packed components
+	const bool is_float = isFloatStorage();
+	Source sources[eVertexAttributeCount] = {
+		{ is_float ? nullptr : (const double*)getVertices(), is_float ? (const float*)getFloatVertices() : nullptr, 3, { 0, 0, 0, 1 } },
+		{ is_float ? nullptr : (const double*)getNormals(), is_float ? (const float*)getFloatNormals() : nullptr, 3, { 0, 0, 0, 0 } },
+		{ is_float ? nullptr : (const double*)getUVs(), is_float ? (const float*)getFloatUVs() : nullptr, 2, { 0, 0, 0, 0 } },
+		{ is_float ? nullptr : (const double*)getColors(), is_float ? (const float*)getFloatColors() : nullptr, 4, { 1, 1, 1, 1 } },
+		{ is_float ? nullptr : (const double*)getTangents(), is_float ? (const float*)getFloatTangents() : nullptr, 3, { 0, 0, 0, 0 } }
+	};
+
+	u8* out = (u8*)dst;
+	for (int i = 0; i < vertex_count; ++i, out += stride)
+	{
+		for (int j = 0; j < layout.count; ++j)
+		{
+			const VertexLayout::Attribute& attr = layout.attributes[j];
+			const Source& src = sources[attr.attribute];
+			const u32 component_size = VertexLayout::GetFormatSize(attr.format);
+			const double* values = src.data ? src.data + (size_t)i * src.dims : nullptr;
+			const float* values_f = src.data_f ? src.data_f + (size_t)i * src.dims : nullptr;
+			const bool has_values = values || values_f;
+
+			u8* ptr = out + attr.offset;
+			for (int k = 0; k < attr.components; ++k, ptr += component_size)
+			{
+				double value = src.defaults[k];
+				if (has_values && k < src.dims) value = values ? values[k] : (double)values_f[k];
+				else if (!has_values && attr.attribute != eVertexColor) value = 0;
+				writeComponent(ptr, attr.format, value);
+			}
+		}
+	}
+	return vertex_count;
+}
+
+
+// copy a vector stream into the other precision, both types have the same components
+template <typename D, typename S> static void convertStream(const std::vector<S>& src, std::vector<D>* dst)
+{
+	typedef decltype(D::x) Component;
+	static_assert(sizeof(S) / sizeof(src[0].x) == sizeof(D) / sizeof(Component), "different component count");
+
+	dst->resize(src.size());
+	if (src.empty()) return;
+
+	const auto* in = &src[0].x;
+	Component* out = &(*dst)[0].x;
+	for (size_t i = 0, c = src.size() * (sizeof(D) / sizeof(Component)); i < c; ++i)
+	{
+		out[i] = (Component)in[i];
+	}
+}
+
+
 struct GeometryImpl : Geometry
 {
 	enum VertexDataMapping
@@ -2020,14 +2975,6 @@ struct GeometryImpl : Geometry
 		BY_VERTEX
 	};
 
-	struct NewVertex
-	{
-		~NewVertex() { delete next; }
-
-		int index = -1;
-		NewVertex* next = nullptr;
-	};
-
 	std::vector<OFBVector3> vertices;
 	std::vector<OFBVector3> normals;
 	std::vector<OFBVector2> uvs;
@@ -2035,26 +2982,127 @@ struct GeometryImpl : Geometry
 	std::vector<OFBVector3> tangents;
 	std::vector<int> materials;
 
+	// LoadOptions::float_geometry keeps the streams here and the double ones stay empty until they are asked for,
+	//  without the option it's the other way around
+	std::vector<OFBVector3f> vertices_f;
+	std::vector<OFBVector3f> normals_f;
+	std::vector<OFBVector2f> uvs_f;
+	std::vector<OFBVector4f> colors_f;
+	std::vector<OFBVector3f> tangents_f;
+	bool is_float = false;
+	mutable std::once_flag convert_flag;
+
 	const Skin* skin = nullptr;
 
 	std::vector<int> to_old_vertices;
-	std::vector<NewVertex> to_new_vertices;
+	// control point -> new vertices remap, the new vertices of the control point i are
+	//  to_new_indices[to_new_offsets[i]] .. to_new_indices[to_new_offsets[i + 1] - 1]
+	std::vector<int> to_new_offsets;
+	std::vector<int> to_new_indices;
+	// triangle list into the vertex streams, only with LoadOptions::weld_vertices
+	std::vector<int> indices;
+	bool is_welded = false;
+
+	// arrays of LoadOptions::cache_path, copied instead of decoding the element
+	const SceneCache* cache = nullptr;
+	const SceneCache::Entry* cache_entry = nullptr;
+
+	// lazy mode, the data above is filled by decode() on the first access
+	bool is_lazy = false;
+	mutable std::once_flag decode_flag;
+	mutable bool is_decoded = true;
+	mutable const char* decode_error = "";	// Error::s_message of the failed decode, it's per thread
 
 	GeometryImpl(const Scene& _scene, const IElement& _element)
 		: Geometry(_scene, _element)
 	{
 	}
 
+	bool decode();
+
+	bool Prefetch() const override
+	{
+		if (is_lazy)
+		{
+			std::call_once(decode_flag, [this]() {
+				ParseScope scope;
+				Error::s_message = "";
+				is_decoded = const_cast<GeometryImpl*>(this)->decode();
+				if (!is_decoded) decode_error = *Error::s_message ? Error::s_message : "Invalid geometry";
+			});
+		}
+		// every failing call reports the reason, on whichever thread it's made
+		if (!is_decoded) Error::s_message = decode_error;
+		return is_decoded;
+	}
+
+	// float storage, the doubles are dropped once the streams are narrowed
+	void narrowStreams()
+	{
+		convertStream(vertices, &vertices_f);
+		convertStream(normals, &normals_f);
+		convertStream(uvs, &uvs_f);
+		convertStream(colors, &colors_f);
+		convertStream(tangents, &tangents_f);
+
+		std::vector<OFBVector3>().swap(vertices);
+		std::vector<OFBVector3>().swap(normals);
+		std::vector<OFBVector2>().swap(uvs);
+		std::vector<OFBVector4>().swap(colors);
+		std::vector<OFBVector3>().swap(tangents);
+	}
+
+	// make the streams of the other precision on the first access of them
+	void requireStreams(bool float_streams) const
+	{
+		Prefetch();
+		if (float_streams == is_float) return;
+
+		std::call_once(convert_flag, [this]() {
+			GeometryImpl* geom = const_cast<GeometryImpl*>(this);
+			if (is_float)
+			{
+				convertStream(vertices_f, &geom->vertices);
+				convertStream(normals_f, &geom->normals);
+				convertStream(uvs_f, &geom->uvs);
+				convertStream(colors_f, &geom->colors);
+				convertStream(tangents_f, &geom->tangents);
+			}
+			else
+			{
+				convertStream(vertices, &geom->vertices_f);
+				convertStream(normals, &geom->normals_f);
+				convertStream(uvs, &geom->uvs_f);
+				convertStream(colors, &geom->colors_f);
+				convertStream(tangents, &geom->tangents_f);
+			}
+		});
+	}
+
 
 	Type getType() const override { return Type::GEOMETRY; }
-	int getVertexCount() const override { return (int)vertices.size(); }
-	const OFBVector3* getVertices() const override { return &vertices[0]; }
-	const OFBVector3* getNormals() const override { return normals.empty() ? nullptr : &normals[0]; }
-	const OFBVector2* getUVs() const override { return uvs.empty() ? nullptr : &uvs[0]; }
-	const OFBVector4* getColors() const override { return colors.empty() ? nullptr : &colors[0]; }
-	const OFBVector3* getTangents() const override { return tangents.empty() ? nullptr : &tangents[0]; }
+	int getVertexCount() const override { Prefetch(); return is_float ? (int)vertices_f.size() : (int)vertices.size(); }
+	const OFBVector3* getVertices() const override { requireStreams(false); return vertices.empty() ? nullptr : &vertices[0]; }
+	const OFBVector3* getNormals() const override { requireStreams(false); return normals.empty() ? nullptr : &normals[0]; }
+	const OFBVector2* getUVs() const override { requireStreams(false); return uvs.empty() ? nullptr : &uvs[0]; }
+	const OFBVector4* getColors() const override { requireStreams(false); return colors.empty() ? nullptr : &colors[0]; }
+	const OFBVector3* getTangents() const override { requireStreams(false); return tangents.empty() ? nullptr : &tangents[0]; }
+
+	bool isFloatStorage() const override { return is_float; }
+	const OFBVector3f* getFloatVertices() const override { requireStreams(true); return vertices_f.empty() ? nullptr : &vertices_f[0]; }
+	const OFBVector3f* getFloatNormals() const override { requireStreams(true); return normals_f.empty() ? nullptr : &normals_f[0]; }
+	const OFBVector2f* getFloatUVs() const override { requireStreams(true); return uvs_f.empty() ? nullptr : &uvs_f[0]; }
+	const OFBVector4f* getFloatColors() const override { requireStreams(true); return colors_f.empty() ? nullptr : &colors_f[0]; }
+	const OFBVector3f* getFloatTangents() const override { requireStreams(true); return tangents_f.empty() ? nullptr : &tangents_f[0]; }
 	const Skin* getSkin() const override { return skin; }
-	const int* getMaterials() const override { return materials.empty() ? nullptr : &materials[0]; }
+	const int* getMaterials() const override { Prefetch(); return materials.empty() ? nullptr : &materials[0]; }
+
+	int getControlPointCount() const override { Prefetch(); return to_new_offsets.empty() ? 0 : (int)to_new_offsets.size() - 1; }
+	const int* getControlPointOffsets() const override { Prefetch(); return to_new_offsets.empty() ? nullptr : &to_new_offsets[0]; }
+	const int* getControlPointVertexIndices() const override { Prefetch(); return to_new_indices.empty() ? nullptr : &to_new_indices[0]; }
+	const int* getVertexControlPoints() const override { Prefetch(); return to_old_vertices.empty() ? nullptr : &to_old_vertices[0]; }
+	const int* getIndices() const override { Prefetch(); return indices.empty() ? nullptr : &indices[0]; }
+	int getIndexCount() const override { Prefetch(); return (int)indices.size(); }
 
 
 	void triangulate(const std::vector<int>& old_indices, std::vector<int>* indices, std::vector<int>* to_old)
@@ -2108,10 +3156,22 @@ struct ClusterImpl : Cluster
 	{
 	}
 
-	const int* getIndices() const override { return &indices[0]; }
-	int getIndicesCount() const override { return (int)indices.size(); }
-	const double* getWeights() const override { return &weights[0]; }
-	int getWeightsCount() const override { return (int)weights.size(); }
+	// with lazy geometry the remap is postponed until the skin data is first needed
+	void ensurePostprocessed() const
+	{
+		if (is_lazy)
+		{
+			std::call_once(postprocess_flag, [this]() {
+				ParseScope scope;
+				const_cast<ClusterImpl*>(this)->postprocess();
+			});
+		}
+	}
+
+	const int* getIndices() const override { ensurePostprocessed(); return indices.empty() ? nullptr : &indices[0]; }
+	int getIndicesCount() const override { ensurePostprocessed(); return (int)indices.size(); }
+	const double* getWeights() const override { ensurePostprocessed(); return weights.empty() ? nullptr : &weights[0]; }
+	int getWeightsCount() const override { ensurePostprocessed(); return (int)weights.size(); }
 	OFBMatrix getTransformMatrix() const override { return transform_matrix; }
 	OFBMatrix getTransformLinkMatrix() const override { return transform_link_matrix; }
 	Object* getLink() const override { return link; }
@@ -2123,15 +3183,19 @@ struct ClusterImpl : Cluster
 
 		GeometryImpl* geom = (GeometryImpl*)skin->resolveObjectLinkReverse(Object::Type::GEOMETRY);
 		if (!geom) return false;
+		if (!geom->Prefetch()) return false;
 
-		std::vector<int> old_indices;
+		ParseContext& context = getParseContext();
+		std::vector<int>& old_indices = context.cluster_indices;
+		old_indices.clear();
 		const Element* indexes = findChild((const Element&)element, "Indexes");
 		if (indexes && indexes->first_property)
 		{
 			if (!parseBinaryArray(*indexes->first_property, &old_indices)) return false;
 		}
 
-		std::vector<double> old_weights;
+		std::vector<double>& old_weights = context.cluster_weights;
+		old_weights.clear();
 		const Element* weights_el = findChild((const Element&)element, "Weights");
 		if (weights_el && weights_el->first_property)
 		{
@@ -2140,21 +3204,31 @@ struct ClusterImpl : Cluster
 
 		if (old_indices.size() != old_weights.size()) return false;
 
-		indices.reserve(old_indices.size());
-		weights.reserve(old_indices.size());
+		const int control_points = geom->getControlPointCount();
+		const int* offsets = geom->getControlPointOffsets();
+		const int* new_indices = geom->getControlPointVertexIndices();
+
+		// exact size, every control point expands into its new vertices
+		size_t count = 0;
+		for (int old_idx : old_indices)
+		{
+			if (old_idx >= 0 && old_idx < control_points) count += offsets[old_idx + 1] - offsets[old_idx];
+		}
+		indices.reserve(count);
+		weights.reserve(count);
+
 		int* ir = old_indices.empty() ? nullptr : &old_indices[0];
 		double* wr = old_weights.empty() ? nullptr : &old_weights[0];
 		for (int i = 0, c = (int)old_indices.size(); i < c; ++i)
 		{
 			int old_idx = ir[i];
+			if (old_idx < 0 || old_idx >= control_points) continue;
 			double w = wr[i];
-			GeometryImpl::NewVertex* n = &geom->to_new_vertices[old_idx];
-			if (n->index == -1) continue; // skip vertices which aren't indexed.
-			while (n)
+			// vertices which aren't indexed have an empty range
+			for (int j = offsets[old_idx], end = offsets[old_idx + 1]; j < end; ++j)
 			{
-				indices.push_back(n->index);
+				indices.push_back(new_indices[j]);
 				weights.push_back(w);
-				n = n->next;
 			}
 		}
 
@@ -2166,6 +3240,8 @@ struct ClusterImpl : Cluster
 	Skin* skin = nullptr;
 	std::vector<int> indices;
 	std::vector<double> weights;
+	bool is_lazy = false;
+	mutable std::once_flag postprocess_flag;
 	OFBMatrix transform_matrix;
 	OFBMatrix transform_link_matrix;
 	Type getType() const override { return Type::CLUSTER; }
@@ -2341,6 +3417,44 @@ struct AnimationCurveImpl : AnimationCurve
 		mLastEvalValue = 0.0f;
 	}
 
+	// index of the first key with time >= fbx_time, starting from 1, times must be clamped to the key range
+	//  the hinted segment and its successor are tried first, so playback going forward is O(1)
+	size_t FindSegment(const i64 fbx_time, size_t &hint) const
+	{
+		const size_t count = times.size();
+		const i64* keys = times.data();
+
+		if (hint < 1) hint = 1;
+		for (size_t i = hint, last = std::min(hint + 2, count); i < last; ++i)
+		{
+			if (keys[i] >= fbx_time && keys[i - 1] < fbx_time)
+			{
+				hint = i;
+				return i;
+			}
+		}
+
+		hint = std::lower_bound(keys + 1, keys + count, fbx_time) - keys;
+		return hint;
+	}
+
+	double Evaluate(EvaluationContext &context) const override
+	{
+		const size_t count = values.size();
+		if (count < 2) return 0.0f;
+
+		i64 fbx_time(context.GetTime().Get());
+		if (fbx_time < times[0]) fbx_time = times[0];
+		if (fbx_time > times[count - 1]) fbx_time = times[count - 1];
+
+		u32* segment = context.GetCurveSegment(*this);
+		size_t hint = segment ? *segment : 1;
+		const size_t i = FindSegment(fbx_time, hint);
+		if (segment) *segment = (u32)hint;
+
+		return Interpolate(fbx_time, i);
+	}
+
 	double Evaluate(const OFBTime &time) const override
 	{
 		if (mLastEvalTime.Get() == time.Get())
@@ -2354,40 +3468,119 @@ struct AnimationCurveImpl : AnimationCurve
 			size_t count = values.size();
 			float result = 0.0f;
 
-			if (count > 0)
+			if (count > 1)
 			{
 				i64 fbx_time(time.Get());
 
 				if (fbx_time < times[0]) fbx_time = times[0];
 				if (fbx_time > times[count - 1]) fbx_time = times[count - 1];
 
-				for (size_t i = 1; i < count; ++i)
-				{
-					if (times[i] >= fbx_time)
-					{
-						float t = float(double(fbx_time - times[i - 1]) / double(times[i] - times[i - 1]));
-						result = values[i - 1] * (1 - t) + values[i] * t;
-						break;
-					}
-				}
+				const size_t i = FindSegment(fbx_time, mLastSegment);
+				result = Interpolate(fbx_time, i);
 			}
+			mLastEvalValue = result;
 			return result;
 		}
 		
 	}
 
-	int getKeyCount() const override { return (int)times.size(); }
-	const i64* getKeyTime() const override { return &times[0]; }
-	const float* getKeyValue() const override { return &values[0]; }
-	const int *getKeyFlag() const override { return &flags[0]; }
+	void EvaluateRange(i64 start, i64 step, int count, float* out) const override { EvaluateRangeT(start, step, count, out); }
+	void EvaluateRange(i64 start, i64 step, int count, double* out) const override { EvaluateRangeT(start, step, count, out); }
 
-	std::vector<i64>	times;
-	std::vector<float>	values;
-	std::vector<int>	flags;
+	// value at a clamped time inside segment [i - 1, i], same arithmetic as Evaluate()
+	float Interpolate(const i64 fbx_time, const size_t i) const
+	{
+		float t = float(double(fbx_time - times[i - 1]) / double(times[i] - times[i - 1]));
+		return values[i - 1] * (1 - t) + values[i] * t;
+	}
 
-	// cache
-	OFBTime		mLastEvalTime;
-	float		mLastEvalValue;
+	template <typename T> void EvaluateRangeT(const i64 start, const i64 step, const int count, T* out) const
+	{
+		const size_t key_count = values.size();
+		if (key_count < 2)
+		{
+			for (int k = 0; k < count; ++k) out[k] = 0;
+			return;
+		}
+
+		const i64* keys = times.data();
+		const i64 first = keys[0];
+		const i64 last = keys[key_count - 1];
+
+		if (step < 0)
+		{
+			for (int k = 0; k < count; ++k)
+			{
+				const i64 fbx_time = std::min(std::max(start + step * k, first), last);
+				const size_t i = std::lower_bound(keys + 1, keys + key_count, fbx_time) - keys;
+				out[k] = (T)Interpolate(fbx_time, i);
+			}
+			return;
+		}
+
+		// number of samples from index k with time <= limit
+		auto samplesUntil = [start, step, count](int k, i64 limit) -> int {
+			if (step == 0) return (start <= limit) ? count : k;
+			if (start > limit) return k;
+			const i64 n = (limit - start) / step + 1;
+			return (n < (i64)count) ? (int)n : count;
+		};
+
+		int k = 0;
+
+		// clamped to the first key
+		const int before = samplesUntil(k, first);
+		if (before > k)
+		{
+			const T value = (T)Interpolate(first, 1);
+			for (; k < before; ++k) out[k] = value;
+		}
+
+		size_t seg = 1;
+		while (k < count)
+		{
+			const i64 fbx_time = start + step * k;
+			if (fbx_time >= last) break;
+
+			while (keys[seg] < fbx_time) ++seg;
+
+			// every sample up to the end key of the segment shares the key pair
+			const i64 key0 = keys[seg - 1];
+			const i64 key1 = keys[seg];
+			const double length = double(key1 - key0);
+			const float value0 = values[seg - 1];
+			const float value1 = values[seg];
+
+			const int end = samplesUntil(k, key1);
+			for (; k < end; ++k)
+			{
+				const float t = float(double(start + step * k - key0) / length);
+				out[k] = (T)(value0 * (1 - t) + value1 * t);
+			}
+		}
+
+		// clamped to the last key
+		if (k < count)
+		{
+			const size_t i = std::lower_bound(keys + 1, keys + key_count, last) - keys;
+			const T value = (T)Interpolate(last, i);
+			for (; k < count; ++k) out[k] = value;
+		}
+	}
+
+	int getKeyCount() const override { return (int)times.size(); }
+	const i64* getKeyTime() const override { return &times[0]; }
+	const float* getKeyValue() const override { return &values[0]; }
+	const int *getKeyFlag() const override { return &flags[0]; }
+
+	std::vector<i64>	times;
+	std::vector<float>	values;
+	std::vector<int>	flags;
+
+	// cache
+	OFBTime		mLastEvalTime;
+	mutable float	mLastEvalValue;
+	mutable size_t	mLastSegment = 1;	// segment [mLastSegment - 1, mLastSegment] of the last evaluation
 
 	Type getType() const override { return Type::ANIMATION_CURVE; }
 };
@@ -2476,6 +3669,56 @@ struct Scene : IScene
 		u64 to;
 		DataView srcProperty;
 		DataView property;
+		u32 property_hash = 0;	// hashName() of property
+	};
+
+	// CSR adjacency over m_connections keyed by one of the connection ends
+	//  the connections of a key keep their file order
+	struct ConnectionIndex
+	{
+		std::vector<u64> keys;			// sorted unique ids
+		std::vector<u32> offsets;		// keys.size() + 1 entries into connections
+		std::vector<u32> connections;	// indices into m_connections
+
+		void build(const std::vector<Connection>& all, u64 Connection::*key)
+		{
+			std::vector<std::pair<u64, u32>> pairs;
+			pairs.reserve(all.size());
+			for (u32 i = 0, count = (u32)all.size(); i < count; ++i)
+			{
+				pairs.emplace_back(all[i].*key, i);
+			}
+			std::sort(pairs.begin(), pairs.end());
+
+			keys.clear();
+			offsets.clear();
+			connections.clear();
+			connections.reserve(pairs.size());
+			for (const auto& pair : pairs)
+			{
+				if (keys.empty() || keys.back() != pair.first)
+				{
+					keys.push_back(pair.first);
+					offsets.push_back((u32)connections.size());
+				}
+				connections.push_back(pair.second);
+			}
+			offsets.push_back((u32)connections.size());
+		}
+
+		// [begin, end) range of connection indices for the id, empty when there's none
+		void find(u64 id, const u32*& begin, const u32*& end) const
+		{
+			auto iter = std::lower_bound(keys.begin(), keys.end(), id);
+			if (iter == keys.end() || *iter != id)
+			{
+				begin = end = nullptr;
+				return;
+			}
+			const size_t idx = iter - keys.begin();
+			begin = connections.data() + offsets[idx];
+			end = connections.data() + offsets[idx + 1];
+		}
 	};
 
 	struct ObjectPair
@@ -2554,30 +3797,14 @@ struct Scene : IScene
 		return nullptr;
 	}
 
-	bool PrepTakeConnections(const int takeIndex) override
-	{
-		AnimationStack *pStack = m_animation_stacks[takeIndex];
-
-		
-		const int layerCount = pStack->getLayerCount();
-
-		// detach all object properties anim nodes
-
-		for (auto iter = begin(m_all_objects); iter != end(m_all_objects); ++iter)
-		{
-			(*iter)->mProperties.DetachAnimNodes();
-
-			// start a new attachments from a base layer
-			//  layers are sorted under the stack
-
-			for (int i = 0; i < layerCount; ++i)
-			{
-				const AnimationLayer *pLayer = pStack->getLayer(i);
-				(*iter)->mProperties.AttachAnimNodes(pLayer);
-			}
-		}
+	bool PrepTakeConnections(const int takeIndex) override;
+	bool SaveCache(const char* path) const override;
 
-		return true;
+	// remember the property to detach it on the next take switch
+	void attachAnimationNode(PropertyAnimatable* prop, const AnimationCurveNode* node) const
+	{
+		if (!prop->IsAnimated()) m_animated_properties.push_back(prop);
+		prop->AttachAnimationNode(node);
 	}
 
 	const IElement* getRootElement() const override { return m_root_element; }
@@ -2593,11 +3820,11 @@ struct Scene : IScene
 		{
 			delete iter.second.object;
 		}
-		
-		deleteElement(m_root_element);
+		// the token tree is released together with m_allocator
 	}
 
 
+	Allocator m_allocator;	// owns m_root_element and the whole token tree
 	Element* m_root_element = nullptr;
 	Root* m_root = nullptr;
 	float m_scene_frame_rate = -1;
@@ -2611,11 +3838,27 @@ struct Scene : IScene
 	std::vector<Constraint*>	mConstraints;
 	std::vector<AnimationStack*> m_animation_stacks;
 	std::vector<Connection> m_connections;
-	std::vector<u8> m_data;
+	ConnectionIndex m_connections_to;	// incoming connections of an object (its children)
+	ConnectionIndex m_connections_from;	// outgoing connections of an object (its parents)
+	std::vector<u8> m_data;	// empty when the scene borrows the caller buffer (LoadOptions::copy_data == false)
 	std::vector<TakeInfo> m_take_infos;
+	mutable std::vector<PropertyAnimatable*> m_animated_properties;	// properties with attached curve nodes, PropertyList::AttachAnimNodes() included
+	OFBMappedFile m_file;	// source mapping when the scene is created with loadFile()
+	const LoadStream* m_stream = nullptr;	// source of loadStream() while it's being tokenized
+	const u8* m_source = nullptr;	// tokenized buffer, the key of SaveCache(), nullptr for a streamed binary source
+	size_t m_source_size = 0;
+	SceneCache m_cache;	// LoadOptions::cache_path
+	LoadProgress m_progress;	// LoadOptions::progress
+	LoadOptions m_options;
 };
 
 
+void AttachSceneAnimationNode(const IScene& scene, PropertyAnimatable* pProp, const AnimationCurveNode* pAnimNode)
+{
+	((const Scene&)scene).attachAnimationNode(pProp, pAnimNode);
+}
+
+
 struct AnimationCurveNodeImpl : AnimationCurveNode
 {
 	AnimationCurveNodeImpl(const Scene& _scene, const IElement& _element)
@@ -2694,6 +3937,15 @@ struct AnimationCurveNodeImpl : AnimationCurveNode
 		return true;
 	}
 
+	bool Evaluate(double *Data, EvaluationContext &context) const override
+	{
+		for (int i = 0; i < mNumberOfCurves; ++i)
+		{
+			Data[i] = curves[i].curve->Evaluate(context);
+		}
+		return true;
+	}
+
 	struct Curve
 	{
 		const AnimationCurve* curve = nullptr;
@@ -2763,20 +4015,102 @@ struct AnimationLayerImpl : AnimationLayer
 
 	const AnimationCurveNode* getCurveNode(const Object& obj, const char* prop) const override
 	{
-		for (const AnimationCurveNodeImpl* node : curve_nodes)
+		return findCurveNode(&obj, hashName(prop), prop);
+	}
+
+	// the first curve node in the layer order which is connected to the owner property
+	const AnimationCurveNodeImpl* findCurveNode(const Object* owner, u32 hash, const char* prop) const
+	{
+		CurveNodeKey key;
+		key.owner = owner;
+		key.hash = hash;
+		key.node = nullptr;
+		auto iter = std::lower_bound(curve_node_index.begin(), curve_node_index.end(), key);
+		for (; iter != curve_node_index.end() && iter->owner == owner && iter->hash == hash; ++iter)
 		{
-			if (node->bone_link_property == prop && node->GetOwner() == &obj) return node;
+			if (iter->node->bone_link_property == prop) return iter->node;
 		}
 		return nullptr;
 	}
 
+	// (owner, property hash) lookup of the curve nodes, built once the connections are resolved
+	void buildCurveNodeIndex()
+	{
+		curve_node_index.clear();
+		curve_node_index.reserve(curve_nodes.size());
+		for (const AnimationCurveNodeImpl* node : curve_nodes)
+		{
+			if (!node->GetOwner()) continue;
+
+			CurveNodeKey key;
+			key.owner = node->GetOwner();
+			key.hash = hashName(node->bone_link_property.begin, node->bone_link_property.end);
+			key.node = node;
+			curve_node_index.push_back(key);
+		}
+		// equal keys keep the connection order
+		std::stable_sort(curve_node_index.begin(), curve_node_index.end());
+	}
+
+	struct CurveNodeKey
+	{
+		const Object* owner;
+		u32 hash;
+		const AnimationCurveNodeImpl* node;
+
+		bool operator<(const CurveNodeKey& rhs) const
+		{
+			if (owner != rhs.owner) return std::less<const Object*>()(owner, rhs.owner);
+			return hash < rhs.hash;
+		}
+	};
+
 	AnimationLayer			*parentLayer;
 
 	std::vector<AnimationLayer*> sublayers;
 	std::vector<AnimationCurveNodeImpl*> curve_nodes;
+	std::vector<CurveNodeKey> curve_node_index;
 };
 
 
+bool Scene::PrepTakeConnections(const int takeIndex)
+{
+	if (takeIndex < 0 || takeIndex >= (int)m_animation_stacks.size()) return false;
+	AnimationStack *pStack = m_animation_stacks[takeIndex];
+
+	// detach the properties of the previous take
+	for (PropertyAnimatable* prop : m_animated_properties)
+	{
+		prop->DetachAnimationNode();
+	}
+	m_animated_properties.clear();
+
+	// start a new attachments from a base layer
+	//  layers are sorted under the stack, the nodes of a layer go straight to their owner property
+	const int layerCount = pStack->getLayerCount();
+	for (int i = 0; i < layerCount; ++i)
+	{
+		const AnimationLayerImpl *pLayer = (const AnimationLayerImpl*)pStack->getLayer(i);
+
+		for (const AnimationLayerImpl::CurveNodeKey& key : pLayer->curve_node_index)
+		{
+			const DataView& name = key.node->bone_link_property;
+			const size_t length = name.end - name.begin;
+
+			PropertyBase* prop = key.node->mOwner->mProperties.Find((const char*)name.begin, length, key.hash);
+			if (!prop || !prop->IsAnimatable()) continue;
+
+			// only the first node of a property in the layer, like getCurveNode() does
+			if (pLayer->findCurveNode(key.node->mOwner, key.hash, prop->GetName()) != key.node) continue;
+
+			attachAnimationNode((PropertyAnimatable*)prop, key.node);
+		}
+	}
+
+	return true;
+}
+
+
 struct OptionalError<Object*> parseTexture(const Scene& scene, const Element& element)
 {
 	TextureImpl* texture = new TextureImpl(scene, element);
@@ -2937,6 +4271,41 @@ static OptionalError<Object*> parseAnimationStack(AnimationStackImpl *pstack)
 
 template<typename T> static bool parseTextArrayRaw(const Property& property, T* out, int max_size);
 
+
+// decoded byte size of a binary array, false when its header is inconsistent
+//  the count comes from the file, so it's checked against the stored bytes before anything is allocated,
+//  deflate can't expand the data more than 1032 times
+static bool getArraySize(const Property& property, u32* size)
+{
+	u32 elem_size = 0;
+	switch (property.type)
+	{
+		case 'l': elem_size = 8; break;
+		case 'd': elem_size = 8; break;
+		case 'f': elem_size = 4; break;
+		case 'i': elem_size = 4; break;
+		default: return false;
+	}
+
+	const u8* data = property.value.begin + sizeof(u32) * 3;
+	if (data > property.value.end) return false;
+
+	const u32 count = *(const u32*)property.value.begin;
+	const u32 enc = *(const u32*)(property.value.begin + 4);
+	const u32 len = *(const u32*)(property.value.begin + 8);
+	if (len > (size_t)(property.value.end - data)) return false;
+
+	const u64 out_size = (u64)elem_size * count;
+	if (out_size > INT_MAX) return false;
+	if (enc == 0 && out_size > len) return false;
+	if (enc == 1 && out_size > (u64)len * 1032) return false;
+	if (enc > 1) return false;
+
+	*size = (u32)out_size;
+	return true;
+}
+
+
 template <typename T> static bool parseArrayRaw(const Property& property, T* out, int max_size)
 {
 	if (property.value.is_binary)
@@ -2969,7 +4338,15 @@ template <typename T> static bool parseArrayRaw(const Property& property, T* out
 		}
 		else if (enc == 1)
 		{
-			if (int(elem_size * count) > max_size) return false;
+			u32 size;
+			if (!getArraySize(property, &size) || (int)size > max_size) return false;
+			// the pre-pass of a parallel load inflates before the objects and their arrays exist,
+			//  so its output is copied, otherwise the inflator writes straight into the destination
+			if (property.inflated)
+			{
+				memcpy(out, property.inflated, elem_size * count);
+				return true;
+			}
 			return decompress(data, len, (u8*)out, elem_size * count);
 		}
 
@@ -2980,52 +4357,44 @@ template <typename T> static bool parseArrayRaw(const Property& property, T* out
 }
 
 
-template <typename T> const char* fromString(const char* str, const char* end, T* val);
-template <> const char* fromString<int>(const char* str, const char* end, int* val)
+// skip to the next value of a text array
+static const char* skipTextSeparator(const char* iter, const char* end)
 {
-	*val = atoi(str);
-	const char* iter = str;
 	while (iter < end && *iter != ',') ++iter;
 	if (iter < end) ++iter; // skip ','
-	return (const char*)iter;
+	return iter;
+}
+
+
+template <typename T> const char* fromString(const char* str, const char* end, T* val);
+template <> const char* fromString<int>(const char* str, const char* end, int* val)
+{
+	return skipTextSeparator(parseTextInteger(str, end, val), end);
 }
 
 
 template <> const char* fromString<u64>(const char* str, const char* end, u64* val)
 {
-	*val = atol(str);
-	const char* iter = str;
-	while (iter < end && *iter != ',') ++iter;
-	if (iter < end) ++iter; // skip ','
-	return (const char*)iter;
+	return skipTextSeparator(parseTextInteger(str, end, val), end);
 }
 
 template <> const char* fromString<i64>(const char* str, const char* end, i64* val)
 {
-	*val = atol(str);
-	const char* iter = str;
-	while (iter < end && *iter != ',') ++iter;
-	if (iter < end) ++iter; // skip ','
-	return (const char*)iter;
+	return skipTextSeparator(parseTextInteger(str, end, val), end);
 }
 
 template <> const char* fromString<double>(const char* str, const char* end, double* val)
 {
-	*val = atof(str);
-	const char* iter = str;
-	while (iter < end && *iter != ',') ++iter;
-	if (iter < end) ++iter; // skip ','
-	return (const char*)iter;
+	return skipTextSeparator(parseTextDouble(str, end, val), end);
 }
 
 
 template <> const char* fromString<float>(const char* str, const char* end, float* val)
 {
-	*val = (float)atof(str);
-	const char* iter = str;
-	while (iter < end && *iter != ',') ++iter;
-	if (iter < end) ++iter; // skip ','
-	return (const char*)iter;
+	double value;
+	const char* iter = skipTextSeparator(parseTextDouble(str, end, &value), end);
+	*val = (float)value;
+	return iter;
 }
 
 
@@ -3034,15 +4403,10 @@ const char* fromString(const char* str, const char* end, double* val, int count)
 	const char* iter = str;
 	for (int i = 0; i < count; ++i)
 	{
-		*val = atof(iter);
+		iter = skipTextSeparator(parseTextDouble(iter, end, val), end);
 		++val;
-		while (iter < end && *iter != ',') ++iter;
-		if (iter < end) ++iter; // skip ','
-
-		if (iter == end) return iter;
-
 	}
-	return (const char*)iter;
+	return iter;
 }
 
 
@@ -3070,30 +4434,42 @@ template <> const char* fromString<OFBMatrix>(const char* str, const char* end,
 }
 
 
+// number of the text array values in one T
+template <typename T> struct TextValueCount { enum { value = 1 }; };
+template <> struct TextValueCount<OFBVector2> { enum { value = 2 }; };
+template <> struct TextValueCount<OFBVector3> { enum { value = 3 }; };
+template <> struct TextValueCount<OFBVector4> { enum { value = 4 }; };
+template <> struct TextValueCount<OFBMatrix> { enum { value = 16 }; };
+
+
+// the array is sized once from the value count of the tokenizer and parsed in place
 template<typename T> static void parseTextArray(const Property& property, std::vector<T>* out)
 {
-	const u8* iter = property.value.begin;
-	for(int i = 0; i < property.count; ++i)
+	out->resize(property.count / TextValueCount<T>::value);
+
+	const char* iter = (const char*)property.value.begin;
+	const char* end = (const char*)property.value.end;
+	T* dst = out->empty() ? nullptr : &(*out)[0];
+	for (size_t i = 0, c = out->size(); i < c; ++i)
 	{
-		T val;
-		iter = (const u8*)fromString<T>((const char*)iter, (const char*)property.value.end, &val);
-		out->push_back(val);
+		iter = fromString<T>(iter, end, dst + i);
 	}
 }
 
 
 template<typename T> static bool parseTextArrayRaw(const Property& property, T* out_raw, int max_size)
 {
-	const u8* iter = property.value.begin;
-	
+	const char* iter = (const char*)property.value.begin;
+	const char* end = (const char*)property.value.end;
+
 	T* out = out_raw;
-	while (iter < property.value.end)
+	T* out_end = out_raw + max_size / sizeof(T);
+	while (iter < end && out < out_end)
 	{
-		iter = (const u8*)fromString<T>((const char*)iter, (const char*)property.value.end, out);
+		iter = fromString<T>(iter, end, out);
 		++out;
-		if (out - out_raw == max_size / sizeof(T)) return true;
 	}
-	return out - out_raw == max_size / sizeof(T);
+	return out == out_end;
 }
 
 
@@ -3111,6 +4487,8 @@ template <typename T> static bool parseBinaryArray(const Property& property, std
 			case 'i': elem_size = 4; break;
 			default: return false;
 		}
+		u32 size;
+		if (!getArraySize(property, &size)) return false;
 		int elem_count = sizeof(T) / elem_size;
 		out->resize(count / elem_count);
 
@@ -3141,7 +4519,7 @@ template <typename T> static bool parseDoubleVecData(Property& property, std::ve
 
 	assert(property.type == 'f');
 	assert(sizeof((*out_vec)[0].x) == sizeof(double));
-	std::vector<float> tmp;
+	std::vector<float>& tmp = getParseContext().floats;
 	if (!parseBinaryArray(property, &tmp)) return false;
 	int elem_count = sizeof((*out_vec)[0]) / sizeof((*out_vec)[0].x);
 	out_vec->resize(tmp.size() / elem_count);
@@ -3280,12 +4658,24 @@ static OptionalError<Object*> parseAnimationCurve(const Scene& scene, const Elem
 {
 	std::unique_ptr<AnimationCurveImpl> curve = std::make_unique<AnimationCurveImpl>(scene, element);
 
+	const SceneCache::Entry* cached = scene.m_cache.find(element.first_property->value.toU64(), Object::Type::ANIMATION_CURVE);
+	if (cached && SceneCache::fits(*cached, SceneCache::CURVE_TIMES, sizeof(i64)) && SceneCache::fits(*cached, SceneCache::CURVE_VALUES, sizeof(float))
+		&& SceneCache::fits(*cached, SceneCache::CURVE_FLAGS, sizeof(int)))
+	{
+		scene.m_cache.read(*cached, SceneCache::CURVE_TIMES, &curve->times);
+		scene.m_cache.read(*cached, SceneCache::CURVE_VALUES, &curve->values);
+		scene.m_cache.read(*cached, SceneCache::CURVE_FLAGS, &curve->flags);
+		if (curve->times.size() == curve->values.size()) return curve.release();
+	}
+
 	const Element* times = findChild(element, "KeyTime");
 	const Element* values = findChild(element, "KeyValueFloat");
 	const Element *flags = findChild(element, "KeyAttrFlags");
 
+	u32 size;
 	if (times && times->first_property)
 	{
+		if (times->first_property->value.is_binary && !getArraySize(*times->first_property, &size)) return Error("Invalid animation curve");
 		curve->times.resize(times->first_property->getCount());
 		if (!times->first_property->getValues(&curve->times[0], (int)curve->times.size() * sizeof(curve->times[0])))
 		{
@@ -3295,6 +4685,7 @@ static OptionalError<Object*> parseAnimationCurve(const Scene& scene, const Elem
 
 	if (values && values->first_property)
 	{
+		if (values->first_property->value.is_binary && !getArraySize(*values->first_property, &size)) return Error("Invalid animation curve");
 		curve->values.resize(values->first_property->getCount());
 		if (!values->first_property->getValues(&curve->values[0], (int)curve->values.size() * sizeof(curve->values[0])))
 		{
@@ -3345,104 +4736,356 @@ static int getTriCountFromPoly(const std::vector<int>& indices, int* idx)
 }
 
 
-static void add(GeometryImpl::NewVertex& vtx, int index)
+// control point -> new vertices table in two passes, count per control point and then fill
+//  the new vertices of every control point end up in ascending order
+static void buildNewVertices(GeometryImpl* geom, int control_points)
 {
-	if (vtx.index == -1)
+	std::vector<int>& offsets = geom->to_new_offsets;
+	std::vector<int>& indices = geom->to_new_indices;
+	const std::vector<int>& to_old = geom->to_old_vertices;
+
+	offsets.assign(control_points + 1, 0);
+	for (int old : to_old)
 	{
-		vtx.index = index;
+		++offsets[old + 1];
 	}
-	else if (vtx.next)
+	for (int i = 0; i < control_points; ++i)
 	{
-		add(*vtx.next, index);
+		offsets[i + 1] += offsets[i];
 	}
-	else
+
+	// offsets[i] moves to the end of its range while filling, a shift by one restores the starts
+	indices.resize(to_old.size());
+	for (int i = 0, c = (int)to_old.size(); i < c; ++i)
+	{
+		indices[offsets[to_old[i]]++] = i;
+	}
+	for (int i = control_points; i > 0; --i)
 	{
-		vtx.next = new GeometryImpl::NewVertex;
-		vtx.next->index = index;
+		offsets[i] = offsets[i - 1];
 	}
+	offsets[0] = 0;
 }
 
 
-static OptionalError<Object*> parseGeometry(const Scene& scene, const Element& element)
+// one stream taking part in the vertex key
+struct WeldStream
 {
-	assert(element.first_property);
+	u8* data;
+	size_t size;	// bytes per vertex
+};
 
-	const Element* vertices_element = findChild(element, "Vertices");
-	if (!vertices_element || !vertices_element->first_property) return Error("Vertices missing");
 
-	const Element* polys_element = findChild(element, "PolygonVertexIndex");
-	if (!polys_element || !polys_element->first_property) return Error("Indices missing");
+static u64 hashVertex(const WeldStream* streams, int stream_count, int vertex)
+{
+	u64 hash = 14695981039346656037ull;
+	for (int i = 0; i < stream_count; ++i)
+	{
+		const u8* data = streams[i].data + streams[i].size * vertex;
+		for (size_t j = 0; j < streams[i].size; j += sizeof(u64))
+		{
+			u64 word;
+			memcpy(&word, data + j, sizeof(word));
+			hash = (hash ^ word) * 1099511628211ull;
+		}
+	}
+	return hash ^ (hash >> 29);
+}
 
-	std::unique_ptr<GeometryImpl> geom = std::make_unique<GeometryImpl>(scene, element);
 
-	std::vector<OFBVector3> vertices;
-	if (!parseDoubleVecData(*vertices_element->first_property, &vertices)) return Error("Failed to parse vertices");
-	std::vector<int> original_indices;
-	if (!parseBinaryArray(*polys_element->first_property, &original_indices)) return Error("Failed to parse indices");
+static bool isSameVertex(const WeldStream* streams, int stream_count, int a, int b)
+{
+	for (int i = 0; i < stream_count; ++i)
+	{
+		const size_t size = streams[i].size;
+		if (memcmp(streams[i].data + size * a, streams[i].data + size * b, size) != 0) return false;
+	}
+	return true;
+}
 
-	std::vector<int> to_old_indices;
-	geom->triangulate(original_indices, &geom->to_old_vertices, &to_old_indices);
-	geom->vertices.resize(geom->to_old_vertices.size());
 
-	for (int i = 0, c = (int)geom->to_old_vertices.size(); i < c; ++i)
+static void compactVertex(const WeldStream* streams, int stream_count, int dst, int src)
+{
+	for (int i = 0; i < stream_count; ++i)
 	{
-		geom->vertices[i] = vertices[geom->to_old_vertices[i]];
+		const size_t size = streams[i].size;
+		memcpy(streams[i].data + size * dst, streams[i].data + size * src, size);
 	}
+}
 
-	geom->to_new_vertices.resize(vertices.size()); // some vertices can be unused, so this isn't necessarily the same size as to_old_vertices.
-	const int* to_old_vertices = geom->to_old_vertices.empty() ? nullptr : &geom->to_old_vertices[0];
-	for (int i = 0, c = (int)geom->to_old_vertices.size(); i < c; ++i)
+
+// merge the corners with the same control point and bitwise equal attributes, fills geom->indices
+//  vertices of different control points are never merged, so the skin stays intact
+static void weldVertices(GeometryImpl* geom)
+{
+	const int count = (int)geom->vertices.size();
+	if (count == 0) return;
+
+	static_assert(sizeof(OFBVector3) % sizeof(u64) == 0 && sizeof(OFBVector2) % sizeof(u64) == 0 && sizeof(OFBVector4) % sizeof(u64) == 0, "vertex streams must be made of 64-bit words");
+
+	// the control point goes into the key next to the attribute streams
+	std::vector<u64> control_points(geom->to_old_vertices.begin(), geom->to_old_vertices.end());
+
+	WeldStream streams[6];
+	int stream_count = 0;
+	auto addStream = [&](void* data, size_t size, size_t item_size) -> bool {
+		if (size == 0) return true;
+		if (size != (size_t)count) return false;
+		streams[stream_count].data = (u8*)data;
+		streams[stream_count].size = item_size;
+		++stream_count;
+		return true;
+	};
+	// a stream which doesn't match the vertex count can't be welded, the mesh stays a triangle list
+	if (!addStream(control_points.data(), control_points.size(), sizeof(u64))
+		|| !addStream(geom->vertices.data(), geom->vertices.size(), sizeof(OFBVector3))
+		|| !addStream(geom->normals.data(), geom->normals.size(), sizeof(OFBVector3))
+		|| !addStream(geom->uvs.data(), geom->uvs.size(), sizeof(OFBVector2))
+		|| !addStream(geom->colors.data(), geom->colors.size(), sizeof(OFBVector4))
+		|| !addStream(geom->tangents.data(), geom->tangents.size(), sizeof(OFBVector3)))
+	{
+		geom->is_welded = false;
+		return;
+	}
+
+	// open addressing table of welded vertex indices, kept at most half full
+	size_t table_size = 16;
+	while (table_size < (size_t)count * 2) table_size <<= 1;
+	const size_t mask = table_size - 1;
+	std::vector<int> table(table_size, -1);
+
+	geom->indices.resize(count);
+	int unique = 0;
+	for (int i = 0; i < count; ++i)
 	{
-		int old = to_old_vertices[i];
-		add(geom->to_new_vertices[old], i);
+		size_t slot = (size_t)hashVertex(streams, stream_count, i) & mask;
+		for (;;)
+		{
+			const int welded = table[slot];
+			if (welded < 0)
+			{
+				// welded vertices only move down, the source vertex is not overwritten yet
+				if (unique != i) compactVertex(streams, stream_count, unique, i);
+				table[slot] = unique;
+				geom->indices[i] = unique;
+				++unique;
+				break;
+			}
+			if (isSameVertex(streams, stream_count, welded, i))
+			{
+				geom->indices[i] = welded;
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
 	}
 
-	const Element* layer_material_element = findChild(element, "LayerElementMaterial");
-	if (layer_material_element)
+	geom->to_old_vertices.resize(unique);
+	for (int i = 0; i < unique; ++i)
 	{
-		const Element* mapping_element = findChild(*layer_material_element, "MappingInformationType");
-		const Element* reference_element = findChild(*layer_material_element, "ReferenceInformationType");
+		geom->to_old_vertices[i] = (int)control_points[i];
+	}
+	geom->vertices.resize(unique);
+	if (!geom->normals.empty()) geom->normals.resize(unique);
+	if (!geom->uvs.empty()) geom->uvs.resize(unique);
+	if (!geom->colors.empty()) geom->colors.resize(unique);
+	if (!geom->tangents.empty()) geom->tangents.resize(unique);
+}
 
-		std::vector<int> tmp;
 
-		if (!mapping_element || !reference_element) return Error("Invalid LayerElementMaterial");
+// attribute stream of a decoded geometry, missing or one item per vertex
+template <typename T> static bool isVertexStream(const std::vector<T>& stream, size_t vertex_count)
+{
+	return stream.empty() || stream.size() == vertex_count;
+}
 
-		if (mapping_element->first_property->value == "ByPolygon" &&
-			reference_element->first_property->value == "IndexToDirect")
-		{
-			geom->materials.reserve(geom->vertices.size() / 3);
-			for (int& i : geom->materials) i = -1;
 
-			const Element* indices_element = findChild(*layer_material_element, "Materials");
-			if (!indices_element || !indices_element->first_property) return Error("Invalid LayerElementMaterial");
+// the streams and remap tables are read getVertexCount() items deep without further checks, so a cached copy
+//  has to be what decodeGeometry would have made: every attribute stream and the material list match the
+//  vertex and triangle counts, every vertex belongs to exactly one control point and the control point
+//  table lists it back
+static bool isCachedGeometryValid(const GeometryImpl& geom)
+{
+	const size_t vertex_count = geom.is_float ? geom.vertices_f.size() : geom.vertices.size();
+	if (geom.is_float)
+	{
+		if (!isVertexStream(geom.normals_f, vertex_count) || !isVertexStream(geom.uvs_f, vertex_count)
+			|| !isVertexStream(geom.colors_f, vertex_count) || !isVertexStream(geom.tangents_f, vertex_count)) return false;
+	}
+	else
+	{
+		if (!isVertexStream(geom.normals, vertex_count) || !isVertexStream(geom.uvs, vertex_count)
+			|| !isVertexStream(geom.colors, vertex_count) || !isVertexStream(geom.tangents, vertex_count)) return false;
+	}
 
-			if (!parseBinaryArray(*indices_element->first_property, &tmp)) return Error("Failed to parse material indices");
+	// welded vertices are shared by the triangles of the index list, otherwise every three vertices are one
+	const size_t triangle_count = (geom.is_welded ? geom.indices.size() : vertex_count) / 3;
+	if (!geom.materials.empty() && geom.materials.size() != triangle_count) return false;
 
-			int tmp_i = 0;
-			for (int poly = 0, c = (int)tmp.size(); poly < c; ++poly)
-			{
-				int tri_count = getTriCountFromPoly(original_indices, &tmp_i);
-				for (int i = 0; i < tri_count; ++i)
-				{
-					geom->materials.push_back(tmp[poly]);
-				}
-			}
-		}
-		else
+	if (geom.to_old_vertices.size() != vertex_count) return false;
+	if (geom.to_new_indices.size() != vertex_count) return false;
+	if (geom.to_new_offsets.empty() || geom.to_new_offsets[0] != 0) return false;
+	if ((size_t)geom.to_new_offsets.back() != vertex_count) return false;
+
+	const int control_points = (int)geom.to_new_offsets.size() - 1;
+	for (int old : geom.to_old_vertices)
+	{
+		if (old < 0 || old >= control_points) return false;
+	}
+
+	for (int i = 0; i < control_points; ++i)
+	{
+		const int from = geom.to_new_offsets[i];
+		const int to = geom.to_new_offsets[i + 1];
+		if (to < from) return false;
+		for (int j = from; j < to; ++j)
 		{
-			if (mapping_element->first_property->value != "AllSame") return Error("Mapping not supported");
+			const int index = geom.to_new_indices[j];
+			if (index < 0 || (size_t)index >= vertex_count || geom.to_old_vertices[index] != i) return false;
 		}
 	}
 
-	const Element* layer_uv_element = findChild(element, "LayerElementUV");
-	if (layer_uv_element)
+	if (geom.indices.size() % 3 != 0) return false;
+	for (int index : geom.indices)
 	{
-		std::vector<OFBVector2> tmp;
-		std::vector<int> tmp_indices;
-		GeometryImpl::VertexDataMapping mapping;
-		if (!parseVertexData(*layer_uv_element, "UV", "UVIndex", &tmp, &tmp_indices, &mapping)) return Error("Invalid UVs");
-		if (!tmp.empty())
-		{
+		if (index < 0 || (size_t)index >= vertex_count) return false;
+	}
+	return true;
+}
+
+
+static bool readCachedGeometry(GeometryImpl* geom)
+{
+	const SceneCache& cache = *geom->cache;
+	const SceneCache::Entry& entry = *geom->cache_entry;
+
+	const size_t real_size = geom->is_float ? sizeof(float) : sizeof(double);
+	const size_t elem_sizes[SceneCache::GEOMETRY_STREAM_COUNT] = {
+		3 * real_size, 3 * real_size, 2 * real_size, 4 * real_size, 3 * real_size,
+		sizeof(int), sizeof(int), sizeof(int), sizeof(int), sizeof(int)};
+	for (int i = 0; i < SceneCache::GEOMETRY_STREAM_COUNT; ++i)
+	{
+		if (!SceneCache::fits(entry, i, elem_sizes[i])) return false;
+	}
+
+	if (geom->is_float)
+	{
+		cache.read(entry, SceneCache::GEOMETRY_VERTICES, &geom->vertices_f);
+		cache.read(entry, SceneCache::GEOMETRY_NORMALS, &geom->normals_f);
+		cache.read(entry, SceneCache::GEOMETRY_UVS, &geom->uvs_f);
+		cache.read(entry, SceneCache::GEOMETRY_COLORS, &geom->colors_f);
+		cache.read(entry, SceneCache::GEOMETRY_TANGENTS, &geom->tangents_f);
+	}
+	else
+	{
+		cache.read(entry, SceneCache::GEOMETRY_VERTICES, &geom->vertices);
+		cache.read(entry, SceneCache::GEOMETRY_NORMALS, &geom->normals);
+		cache.read(entry, SceneCache::GEOMETRY_UVS, &geom->uvs);
+		cache.read(entry, SceneCache::GEOMETRY_COLORS, &geom->colors);
+		cache.read(entry, SceneCache::GEOMETRY_TANGENTS, &geom->tangents);
+	}
+	cache.read(entry, SceneCache::GEOMETRY_MATERIALS, &geom->materials);
+	cache.read(entry, SceneCache::GEOMETRY_TO_OLD_VERTICES, &geom->to_old_vertices);
+	cache.read(entry, SceneCache::GEOMETRY_TO_NEW_OFFSETS, &geom->to_new_offsets);
+	cache.read(entry, SceneCache::GEOMETRY_TO_NEW_INDICES, &geom->to_new_indices);
+	cache.read(entry, SceneCache::GEOMETRY_INDICES, &geom->indices);
+	// a mesh weldVertices had to leave alone is cached as a triangle list
+	const bool is_welded = geom->is_welded;
+	if (geom->indices.empty()) geom->is_welded = false;
+
+	if (isCachedGeometryValid(*geom)) return true;
+
+	// a damaged or foreign cache, decode the element instead
+	geom->vertices.clear();
+	geom->normals.clear();
+	geom->uvs.clear();
+	geom->colors.clear();
+	geom->tangents.clear();
+	geom->vertices_f.clear();
+	geom->normals_f.clear();
+	geom->uvs_f.clear();
+	geom->colors_f.clear();
+	geom->tangents_f.clear();
+	geom->materials.clear();
+	geom->to_old_vertices.clear();
+	geom->to_new_offsets.clear();
+	geom->to_new_indices.clear();
+	geom->indices.clear();
+	geom->is_welded = is_welded;
+	return false;
+}
+
+
+static OptionalError<bool> decodeGeometry(GeometryImpl* geom, const Element& element)
+{
+	if (geom->cache_entry && readCachedGeometry(geom)) return true;
+
+	const Element* vertices_element = findChild(element, "Vertices");
+	const Element* polys_element = findChild(element, "PolygonVertexIndex");
+
+	ParseContext& context = getParseContext();
+	std::vector<OFBVector3>& vertices = context.vertices;
+	if (!parseDoubleVecData(*vertices_element->first_property, &vertices)) return Error("Failed to parse vertices");
+	std::vector<int>& original_indices = context.polygon_indices;
+	if (!parseBinaryArray(*polys_element->first_property, &original_indices)) return Error("Failed to parse indices");
+
+	std::vector<int>& to_old_indices = context.to_old_indices;
+	to_old_indices.clear();
+	geom->triangulate(original_indices, &geom->to_old_vertices, &to_old_indices);
+	geom->vertices.resize(geom->to_old_vertices.size());
+
+	for (int i = 0, c = (int)geom->to_old_vertices.size(); i < c; ++i)
+	{
+		geom->vertices[i] = vertices[geom->to_old_vertices[i]];
+	}
+
+	const Element* layer_material_element = findChild(element, "LayerElementMaterial");
+	if (layer_material_element)
+	{
+		const Element* mapping_element = findChild(*layer_material_element, "MappingInformationType");
+		const Element* reference_element = findChild(*layer_material_element, "ReferenceInformationType");
+
+		std::vector<int>& tmp = context.layer_indices;
+
+		if (!mapping_element || !reference_element) return Error("Invalid LayerElementMaterial");
+
+		if (mapping_element->first_property->value == "ByPolygon" &&
+			reference_element->first_property->value == "IndexToDirect")
+		{
+			geom->materials.reserve(geom->vertices.size() / 3);
+			for (int& i : geom->materials) i = -1;
+
+			const Element* indices_element = findChild(*layer_material_element, "Materials");
+			if (!indices_element || !indices_element->first_property) return Error("Invalid LayerElementMaterial");
+
+			if (!parseBinaryArray(*indices_element->first_property, &tmp)) return Error("Failed to parse material indices");
+
+			int tmp_i = 0;
+			for (int poly = 0, c = (int)tmp.size(); poly < c; ++poly)
+			{
+				int tri_count = getTriCountFromPoly(original_indices, &tmp_i);
+				for (int i = 0; i < tri_count; ++i)
+				{
+					geom->materials.push_back(tmp[poly]);
+				}
+			}
+		}
+		else
+		{
+			if (mapping_element->first_property->value != "AllSame") return Error("Mapping not supported");
+		}
+	}
+
+	const Element* layer_uv_element = findChild(element, "LayerElementUV");
+	if (layer_uv_element)
+	{
+		std::vector<OFBVector2> tmp;
+		std::vector<int>& tmp_indices = context.layer_indices;
+		tmp_indices.clear();
+		GeometryImpl::VertexDataMapping mapping;
+		if (!parseVertexData(*layer_uv_element, "UV", "UVIndex", &tmp, &tmp_indices, &mapping)) return Error("Invalid UVs");
+		if (!tmp.empty())
+		{
 			geom->uvs.resize(tmp_indices.empty() ? tmp.size() : tmp_indices.size());
 			splat(&geom->uvs, mapping, tmp, tmp_indices, original_indices);
 			remap(&geom->uvs, to_old_indices);
@@ -3453,7 +5096,8 @@ static OptionalError<Object*> parseGeometry(const Scene& scene, const Element& e
 	if (layer_tangent_element)
 	{
 		std::vector<OFBVector3> tmp;
-		std::vector<int> tmp_indices;
+		std::vector<int>& tmp_indices = context.layer_indices;
+		tmp_indices.clear();
 		GeometryImpl::VertexDataMapping mapping;
 		if (findChild(*layer_tangent_element, "Tangents"))
 		{
@@ -3474,7 +5118,8 @@ static OptionalError<Object*> parseGeometry(const Scene& scene, const Element& e
 	if (layer_color_element)
 	{
 		std::vector<OFBVector4> tmp;
-		std::vector<int> tmp_indices;
+		std::vector<int>& tmp_indices = context.layer_indices;
+		tmp_indices.clear();
 		GeometryImpl::VertexDataMapping mapping;
 		if (!parseVertexData(*layer_color_element, "Colors", "ColorIndex", &tmp, &tmp_indices, &mapping)) return Error("Invalid colors");
 		if (!tmp.empty())
@@ -3488,7 +5133,8 @@ static OptionalError<Object*> parseGeometry(const Scene& scene, const Element& e
 	if (layer_normal_element)
 	{
 		std::vector<OFBVector3> tmp;
-		std::vector<int> tmp_indices;
+		std::vector<int>& tmp_indices = context.layer_indices;
+		tmp_indices.clear();
 		GeometryImpl::VertexDataMapping mapping;
 		if (!parseVertexData(*layer_normal_element, "Normals", "NormalsIndex", &tmp, &tmp_indices, &mapping)) return Error("Invalid normals");
 		if (!tmp.empty())
@@ -3498,6 +5144,45 @@ static OptionalError<Object*> parseGeometry(const Scene& scene, const Element& e
 		}
 	}
 
+	if (geom->is_welded) weldVertices(geom);
+	if (geom->is_float) geom->narrowStreams();
+
+	// some vertices can be unused, so the control point count isn't necessarily the same as to_old_vertices size
+	buildNewVertices(geom, (int)vertices.size());
+
+	return true;
+}
+
+
+bool GeometryImpl::decode()
+{
+	return !decodeGeometry(this, (const Element&)element).isError();
+}
+
+
+static OptionalError<Object*> parseGeometry(const Scene& scene, const Element& element)
+{
+	assert(element.first_property);
+
+	const Element* vertices_element = findChild(element, "Vertices");
+	if (!vertices_element || !vertices_element->first_property) return Error("Vertices missing");
+
+	const Element* polys_element = findChild(element, "PolygonVertexIndex");
+	if (!polys_element || !polys_element->first_property) return Error("Indices missing");
+
+	std::unique_ptr<GeometryImpl> geom = std::make_unique<GeometryImpl>(scene, element);
+	geom->is_welded = scene.m_options.weld_vertices;
+	geom->is_float = scene.m_options.float_geometry;
+	geom->cache = &scene.m_cache;
+	geom->cache_entry = scene.m_cache.find(element.first_property->value.toU64(), Object::Type::GEOMETRY);
+
+	if (scene.m_options.lazy_geometry)
+	{
+		geom->is_lazy = true;
+		return geom.release();
+	}
+
+	if (decodeGeometry(geom.get(), element).isError()) return Error();
 	return geom.release();
 }
 
@@ -3588,10 +5273,14 @@ static bool parseConnections(const Element& root, Scene* scene)
 			Error::s_message = "Not supported";
 			return false;
 		}
+		c.property_hash = hashName(c.property.begin, c.property.end);
 		scene->m_connections.push_back(c);
 
 		connection = connection->sibling;
 	}
+
+	scene->m_connections_to.build(scene->m_connections, &Scene::Connection::to);
+	scene->m_connections_from.build(scene->m_connections, &Scene::Connection::from);
 	return true;
 }
 
@@ -3737,219 +5426,550 @@ static void parseGlobalSettings(const Element& root, Scene* scene)
 }
 
 
-static bool parseObjects(const Element& root, Scene* scene)
+// object registered under the id, nullptr for unknown ids
+static Object* findObject(const Scene& scene, u64 id)
 {
-	const Element* objs = findChild(root, "Objects");
-	if (!objs) return true;
+	auto iter = scene.m_object_map.find(id);
+	return (iter != scene.m_object_map.end()) ? iter->second.object : nullptr;
+}
 
-	scene->m_root = new Root(*scene, root);
-	scene->m_root->id = 0;
-	scene->m_object_map[0] = {&root, scene->m_root};
 
-	const Element* object = objs->child;
-	while (object)
+// name of an object element matches, either the whole name (binary "Name\0\1Class") or the part after "Class::" (ASCII)
+static bool isObjectName(const Element& element, const char* name)
+{
+	if (!element.first_property || !element.first_property->next) return false;
+
+	const DataView& value = element.first_property->next->value;
+	const u8* end = value.begin;
+	while (end != value.end && *end) ++end;
+
+	DataView view;
+	view.begin = value.begin;
+	view.end = end;
+	if (view == name) return true;
+
+	for (const u8* c = view.begin; c + 1 < view.end; ++c)
 	{
-		if (!isLong(object->first_property))
+		if (c[0] == ':' && c[1] == ':')
 		{
-			Error::s_message = "Invalid";
-			return false;
+			view.begin = c + 2;
+			return view == name;
 		}
-
-		u64 id = object->first_property->value.toU64();
-		scene->m_object_map[id] = {object, nullptr};
-		object = object->sibling;
 	}
+	return false;
+}
 
-	for (auto iter : scene->m_object_map)
-	{
-		OptionalError<Object*> obj = nullptr;
 
-		if (iter.second.object == scene->m_root) continue;
+// collect everything reachable from the object through the incoming connections (stack > layers > curve nodes > curves)
+static void collectAnimationIds(const Scene& scene, u64 id, std::unordered_set<u64>* ids)
+{
+	if (!ids->insert(id).second) return;
+
+	const u32 *begin, *end;
+	scene.m_connections_to.find(id, begin, end);
+	for (const u32* iter = begin; iter != end; ++iter)
+	{
+		const Scene::Connection& connection = scene.m_connections[*iter];
+		auto obj = scene.m_object_map.find(connection.from);
+		if (obj == scene.m_object_map.end() || !obj->second.element) continue;
 
-		if (iter.second.element->id == "Geometry")
+		const DataView& type = obj->second.element->id;
+		if (type == "AnimationLayer" || type == "AnimationCurveNode" || type == "AnimationCurve")
 		{
-			Property* last_prop = iter.second.element->first_property;
-			while (last_prop->next) last_prop = last_prop->next;
-			if (last_prop && last_prop->value == "Mesh")
-			{
-				obj = parseGeometry(*scene, *iter.second.element);
-			}
+			collectAnimationIds(scene, connection.from, ids);
 		}
-		else if (iter.second.element->id == "Material")
-		{
-			obj = parseMaterial(*scene, *iter.second.element);
+	}
+}
 
-			if (!obj.isError())
-			{
-				if (nullptr != obj.getValue())
-				{
-					scene->mMaterials.push_back((Material*)obj.getValue());
-				}
-			}
-		}
-		else if (iter.second.element->id == "Constraint")
-		{
-			IElementProperty* class_prop = iter.second.element->getProperty(2);
 
-			if (class_prop)
-			{
-				if (class_prop->getValue() == "Position From Positions")
-					obj = parse<ConstraintPositionImpl>(*scene, *iter.second.element);
-				else
-					obj = parse<ConstraintImpl>(*scene, *iter.second.element);
-			}
+static bool isAnimationElement(const Element& element)
+{
+	return element.id == "AnimationStack" || element.id == "AnimationLayer" || element.id == "AnimationCurveNode" || element.id == "AnimationCurve";
+}
 
-			if (!obj.isError())
-			{
-				if (nullptr != obj.getValue())
-				{
-					scene->mConstraints.push_back( (Constraint*)obj.getValue());
-				}
-			}
-		}
-		else if (iter.second.element->id == "AnimationStack")
-		{
-			obj = parse<AnimationStackImpl>(*scene, *iter.second.element);
-			if (!obj.isError())
-			{
-				AnimationStackImpl* stack = (AnimationStackImpl*)obj.getValue();
-				if (nullptr != stack)
-				{
-					parseAnimationStack(stack);
-					scene->m_animation_stacks.push_back(stack);
-				}
-			}
-		}
-		else if (iter.second.element->id == "AnimationLayer")
-		{
-			obj = parse<AnimationLayerImpl>(*scene, *iter.second.element);
-		}
-		else if (iter.second.element->id == "AnimationCurve")
-		{
-			obj = parseAnimationCurve(*scene, *iter.second.element);
-		}
-		else if (iter.second.element->id == "AnimationCurveNode")
-		{
-			obj = parseAnimationCurveNode(*scene, *iter.second.element);
-			//obj = parse<AnimationCurveNodeImpl>(*scene, *iter.second.element);
-		}
-		else if (iter.second.element->id == "Deformer")
-		{
-			IElementProperty* class_prop = iter.second.element->getProperty(2);
 
-			if (class_prop)
-			{
-				if (class_prop->getValue() == "Cluster")
-					obj = parseCluster(*scene, *iter.second.element);
-				else if (class_prop->getValue() == "Skin")
-					obj = parse<SkinImpl>(*scene, *iter.second.element);
-			}
-		}
-		else if (iter.second.element->id == "NodeAttribute")
+// LoadOptions::skip_flags test of a single object element
+static bool isSkipped(const Element& element, u32 skip_flags)
+{
+	if (skip_flags & eSkipGeometry)
+	{
+		if (element.id == "Geometry" || element.id == "Deformer") return true;
+	}
+	if (skip_flags & eSkipTextures)
+	{
+		if (element.id == "Texture" || element.id == "Video") return true;
+	}
+	if (skip_flags & eSkipConstraints)
+	{
+		if (element.id == "Constraint") return true;
+	}
+	if (skip_flags & eSkipAnimation)
+	{
+		if (isAnimationElement(element)) return true;
+	}
+	return false;
+}
+
+
+// construct the object of a single element, reads nothing but the element subtree
+//  so it's safe to run for different elements in parallel
+static OptionalError<Object*> parseObject(const Scene& scene, const Element& element)
+{
+	OptionalError<Object*> obj = nullptr;
+
+	if (element.id == "Geometry")
+	{
+		Property* last_prop = element.first_property;
+		while (last_prop->next) last_prop = last_prop->next;
+		if (last_prop && last_prop->value == "Mesh")
 		{
-			obj = parseNodeAttribute(*scene, *iter.second.element);
+			obj = parseGeometry(scene, element);
 		}
-		else if (iter.second.element->id == "Model")
-		{
-			IElementProperty* class_prop = iter.second.element->getProperty(2);
+	}
+	else if (element.id == "Material")
+	{
+		obj = parseMaterial(scene, element);
+	}
+	else if (element.id == "Constraint")
+	{
+		IElementProperty* class_prop = element.getProperty(2);
 
-			if (class_prop)
-			{
-				if (class_prop->getValue() == "Mesh")
-				{
-					obj = parseMesh(*scene, *iter.second.element);
-					if (!obj.isError())
-					{
-						Mesh* mesh = (Mesh*)obj.getValue();
-						scene->m_meshes.push_back(mesh);
-						obj = mesh;
-					}
-				}
-				else if (class_prop->getValue() == "LimbNode")
-					obj = parseLimbNode(*scene, *iter.second.element);
-				else if (class_prop->getValue() == "Null")
-					obj = parse<NullImpl>(*scene, *iter.second.element);
-				else if (class_prop->getValue() == "Root")
-					obj = parse<NullImpl>(*scene, *iter.second.element);
-				else if (class_prop->getValue() == "Camera")
-				{
-					obj = parse<CameraImpl>(*scene, *iter.second.element);
-					if (!obj.isError())
-					{
-						scene->mCameras.push_back((Camera*)obj.getValue());
-					}
-				}
-				else if (class_prop->getValue() == "Light")
-				{
-					obj = parse<LightImpl>(*scene, *iter.second.element);
-					if (!obj.isError())
-					{
-						scene->mLights.push_back((Light*)obj.getValue());
-					}
-				}
-				
-			}
-		}
-		else if (iter.second.element->id == "Texture")
+		if (class_prop)
 		{
-			obj = parseTexture(*scene, *iter.second.element);
+			if (class_prop->getValue() == "Position From Positions")
+				obj = parse<ConstraintPositionImpl>(scene, element);
+			else
+				obj = parse<ConstraintImpl>(scene, element);
 		}
-		else if (iter.second.element->id == "MotionBuilder_Generic")
+	}
+	else if (element.id == "AnimationStack")
+	{
+		obj = parse<AnimationStackImpl>(scene, element);
+		if (!obj.isError())
 		{
-			obj = parseGeneric(*scene, *iter.second.element);
-
-			if (!obj.isError() && nullptr != obj.getValue())
+			AnimationStackImpl* stack = (AnimationStackImpl*)obj.getValue();
+			if (nullptr != stack)
 			{
-				if (Object::Type::SHADER == obj.getValue()->getType())
-				{
-					scene->m_shaders.push_back((Shader*)obj.getValue());
-				}
+				parseAnimationStack(stack);
 			}
 		}
-		
-		if (obj.isError()) return false;
+	}
+	else if (element.id == "AnimationLayer")
+	{
+		obj = parse<AnimationLayerImpl>(scene, element);
+	}
+	else if (element.id == "AnimationCurve")
+	{
+		obj = parseAnimationCurve(scene, element);
+	}
+	else if (element.id == "AnimationCurveNode")
+	{
+		obj = parseAnimationCurveNode(scene, element);
+		//obj = parse<AnimationCurveNodeImpl>(scene, element);
+	}
+	else if (element.id == "Deformer")
+	{
+		IElementProperty* class_prop = element.getProperty(2);
 
-		scene->m_object_map[iter.first].object = obj.getValue();
-		if (obj.getValue())
+		if (class_prop)
 		{
-			scene->m_all_objects.push_back(obj.getValue());
-			obj.getValue()->id = iter.first;
+			if (class_prop->getValue() == "Cluster")
+				obj = parseCluster(scene, element);
+			else if (class_prop->getValue() == "Skin")
+				obj = parse<SkinImpl>(scene, element);
 		}
 	}
+	else if (element.id == "NodeAttribute")
+	{
+		obj = parseNodeAttribute(scene, element);
+	}
+	else if (element.id == "Model")
+	{
+		IElementProperty* class_prop = element.getProperty(2);
 
-	for (const Scene::Connection& con : scene->m_connections)
+		if (class_prop)
+		{
+			if (class_prop->getValue() == "Mesh")
+				obj = parseMesh(scene, element);
+			else if (class_prop->getValue() == "LimbNode")
+				obj = parseLimbNode(scene, element);
+			else if (class_prop->getValue() == "Null")
+				obj = parse<NullImpl>(scene, element);
+			else if (class_prop->getValue() == "Root")
+				obj = parse<NullImpl>(scene, element);
+			else if (class_prop->getValue() == "Camera")
+				obj = parse<CameraImpl>(scene, element);
+			else if (class_prop->getValue() == "Light")
+				obj = parse<LightImpl>(scene, element);
+		}
+	}
+	else if (element.id == "Texture")
 	{
-		Object* parent = scene->m_object_map[con.to].object;
-		Object* child = scene->m_object_map[con.from].object;
-		if (!child) continue;
-		if (!parent) continue;
+		obj = parseTexture(scene, element);
+	}
+	else if (element.id == "MotionBuilder_Generic")
+	{
+		obj = parseGeneric(scene, element);
+	}
 
-		PropertyBase *objProperty = parent->mProperties.GetFirst();
+	return obj;
+}
 
-		if (Scene::Connection::OBJECT_PROPERTY == con.type)
-		{
-			if (con.property == "LookAtProperty")
-			{
-				printf("test\n");
-			}
 
-			if (Object::Type::ANIMATION_CURVE_NODE != child->getType() 
-				&& Object::Type::NODE_ATTRIBUTE != child->getType() )
-			{
-				while (objProperty)
-				{
-					if (con.property == objProperty->GetName() 
-						&& ePT_object == objProperty->GetPropertyType())
-					{
-						((PropertyObject*) objProperty)->SetPropertyValue(child);
-						break;
-					}
-					objProperty = objProperty->GetNext();
-				}
-			}
-		}
+// one entry of the object construction phase
+struct ObjectJob
+{
+	const Scene* scene;
+	ParseContextPool* contexts;
+	const Element* element;
+	u64 id;
+	Object* object;
+	bool is_error;
+	const char* error;	// Error::s_message of the worker thread
+	double time;	// with LoadOptions::stats
+};
 
-		objProperty = parent->mProperties.GetFirst();
+
+static void parseObjectJob(void* data)
+{
+	ObjectJob* job = (ObjectJob*)data;
+	const bool is_timed = job->scene->m_options.stats != nullptr;
+	const double start = is_timed ? getStatsTime() : 0.0;
+
+	PooledParseScope scope(*job->contexts);
+	Error::s_message = "";
+	OptionalError<Object*> obj = parseObject(*job->scene, *job->element);
+	job->is_error = obj.isError();
+	job->object = job->is_error ? nullptr : obj.getValue();
+	if (job->is_error) job->error = Error::s_message;
+
+	if (is_timed) job->time = getStatsTime() - start;
+}
+
+
+// one compressed array of the inflate pre-pass
+struct InflateJob
+{
+	ParseContextPool* contexts;
+	Property* property;
+	u8* out;
+	u32 out_size;
+};
+
+
+static void inflateArrayJob(void* data)
+{
+	InflateJob* job = (InflateJob*)data;
+	PooledParseScope scope(*job->contexts);
+	const Property& prop = *job->property;
+	const u32 len = *(const u32*)(prop.value.begin + 8);
+	const u8* in = prop.value.begin + sizeof(u32) * 3;
+	if (decompress(in, len, job->out, job->out_size)) job->property->inflated = job->out;
+}
+
+
+// compressed array of the first child with the id
+static bool collectCompressedArray(const Element* parent, const char* id, Allocator& allocator, std::vector<InflateJob>* jobs)
+{
+	const Element* element = parent ? findChild(*parent, id) : nullptr;
+	Property* prop = element ? element->first_property : nullptr;
+	if (!prop || !prop->value.is_binary) return true;
+	if (prop->type != 'l' && prop->type != 'd' && prop->type != 'f' && prop->type != 'i') return true;
+	if (prop->value.begin + sizeof(u32) * 3 > prop->value.end) return true;
+
+	const u32 enc = *(const u32*)(prop->value.begin + 4);
+	u32 out_size;
+	// an invalid header is reported by the consumer
+	if (enc != 1 || !getArraySize(*prop, &out_size) || out_size == 0) return true;
+
+	u8* out = (u8*)allocator.allocate(out_size, 8);
+	if (!out) return false;
+	jobs->push_back({nullptr, prop, out, out_size});
+	return true;
+}
+
+
+// the arrays read by parseGeometry(), parseAnimationCurve() and the cluster postprocess,
+//  the same first layer of each kind decodeGeometry() finds. false when out of memory
+static bool collectCompressedArrays(const Scene& scene, const Element& element, Allocator& allocator, std::vector<InflateJob>* jobs)
+{
+	if (element.id == "Geometry")
+	{
+		// only mesh geometry is parsed
+		const Property* last_prop = element.first_property;
+		while (last_prop && last_prop->next) last_prop = last_prop->next;
+		if (!last_prop || last_prop->value != "Mesh") return true;
+
+		const Element* material = findChild(element, "LayerElementMaterial");
+		const Element* uv = findChild(element, "LayerElementUV");
+		const Element* tangent = findChild(element, "LayerElementTangents");
+		const Element* color = findChild(element, "LayerElementColor");
+		const Element* normal = findChild(element, "LayerElementNormal");
+		return collectCompressedArray(&element, "Vertices", allocator, jobs)
+			&& collectCompressedArray(&element, "PolygonVertexIndex", allocator, jobs)
+			&& collectCompressedArray(material, "Materials", allocator, jobs)
+			&& collectCompressedArray(uv, "UV", allocator, jobs)
+			&& collectCompressedArray(uv, "UVIndex", allocator, jobs)
+			&& collectCompressedArray(tangent, "Tangents", allocator, jobs)
+			&& collectCompressedArray(tangent, "TangentsIndex", allocator, jobs)
+			&& collectCompressedArray(tangent, "Tangent", allocator, jobs)
+			&& collectCompressedArray(tangent, "TangentIndex", allocator, jobs)
+			&& collectCompressedArray(color, "Colors", allocator, jobs)
+			&& collectCompressedArray(color, "ColorIndex", allocator, jobs)
+			&& collectCompressedArray(normal, "Normals", allocator, jobs)
+			&& collectCompressedArray(normal, "NormalsIndex", allocator, jobs);
+	}
+	if (element.id == "AnimationCurve")
+	{
+		return collectCompressedArray(&element, "KeyTime", allocator, jobs)
+			&& collectCompressedArray(&element, "KeyValueFloat", allocator, jobs);
+	}
+	// a lazy cluster is postprocessed after the load, when the pre-pass buffers are gone
+	if (element.id == "Deformer" && !scene.m_options.lazy_geometry)
+	{
+		return collectCompressedArray(&element, "Indexes", allocator, jobs)
+			&& collectCompressedArray(&element, "Weights", allocator, jobs);
+	}
+	return true;
+}
+
+
+// decoded arrays of the inflate pre-pass, they live only during parseObjects()
+struct InflateBuffers
+{
+	~InflateBuffers()
+	{
+		for (const InflateJob& job : jobs) job.property->inflated = nullptr;
+	}
+
+	Allocator allocator;
+	std::vector<InflateJob> jobs;
+};
+
+
+static bool reportLoadJobs(u32 done, u32 count, void* user_ptr)
+{
+	return ((LoadProgress*)user_ptr)->report(float(done) / float(count));
+}
+
+
+// RunJobs() of the load, with LoadOptions::progress the callback runs on the loading thread
+//  between its own jobs, so it can cancel the jobs which haven't started yet
+static bool runLoadJobs(Scene* scene, JobFunction fn, void* data, u32 size, u32 count)
+{
+	const LoadOptions& options = scene->m_options;
+	LoadProgress& progress = scene->m_progress;
+	if (!progress.callback)
+	{
+		RunJobs(fn, data, size, count, options.thread_count, options.job_processor, options.job_user_ptr);
+		return true;
+	}
+
+	return RunJobsWithProgress(fn, data, size, count, options.thread_count, reportLoadJobs, &progress, options.job_processor, options.job_user_ptr);
+}
+
+
+// inflate the compressed arrays of the elements up front in parallel, so a big geometry isn't inflated by one thread
+//  parseArrayRaw() copies from the buffers, they are released at the end of parseObjects()
+static bool inflateArrays(Scene* scene, const std::vector<const Element*>& elements, ParseContextPool* contexts, InflateBuffers* buffers)
+{
+	std::vector<InflateJob>& jobs = buffers->jobs;
+	for (const Element* element : elements)
+	{
+		if (!collectCompressedArrays(*scene, *element, buffers->allocator, &jobs))
+		{
+			Error::s_message = "Out of memory";
+			return false;
+		}
+	}
+	for (InflateJob& job : jobs) job.contexts = contexts;
+
+	const LoadOptions& options = scene->m_options;
+	const bool is_done = runLoadJobs(scene, inflateArrayJob, jobs.data(), (u32)sizeof(InflateJob), (u32)jobs.size());
+
+	if (LoadStats* stats = options.stats)
+	{
+		for (const InflateJob& job : jobs)
+		{
+			if (job.property->inflated != job.out) continue;
+			stats->bytes_inflated += job.out_size;
+			++stats->arrays_inflated;
+		}
+	}
+	return is_done;
+}
+
+
+static bool parseObjects(const Element& root, Scene* scene)
+{
+	const Element* objs = findChild(root, "Objects");
+	if (!objs) return true;
+
+	scene->m_root = new Root(*scene, root);
+	scene->m_root->id = 0;
+	scene->m_object_map[0] = {&root, scene->m_root};
+
+	const LoadOptions& options = scene->m_options;
+
+	const Element* object = objs->child;
+	while (object)
+	{
+		if (!isLong(object->first_property))
+		{
+			Error::s_message = "Invalid";
+			return false;
+		}
+
+		if (!isSkipped(*object, options.skip_flags))
+		{
+			u64 id = object->first_property->value.toU64();
+			scene->m_object_map[id] = {object, nullptr};
+		}
+		object = object->sibling;
+	}
+
+	// keep only the animation of the requested stack
+	if (options.animation_stack && !(options.skip_flags & eSkipAnimation))
+	{
+		std::unordered_set<u64> animation_ids;
+		for (auto iter : scene->m_object_map)
+		{
+			const Element* element = iter.second.element;
+			if (element != &root && element->id == "AnimationStack" && isObjectName(*element, options.animation_stack))
+			{
+				collectAnimationIds(*scene, iter.first, &animation_ids);
+			}
+		}
+
+		for (auto iter = scene->m_object_map.begin(); iter != scene->m_object_map.end();)
+		{
+			const Element* element = iter->second.element;
+			if (element != &root && isAnimationElement(*element) && animation_ids.find(iter->first) == animation_ids.end())
+				iter = scene->m_object_map.erase(iter);
+			else
+				++iter;
+		}
+	}
+
+	// scratch buffers of the inflate and object jobs
+	ParseContextPool contexts;
+
+	// objects are constructed independently (in parallel when requested),
+	//  then registered in map order so the output does not depend on the thread count
+	std::vector<ObjectJob> jobs;
+	jobs.reserve(scene->m_object_map.size());
+	for (auto iter : scene->m_object_map)
+	{
+		if (iter.second.object == scene->m_root) continue;
+		jobs.push_back({scene, &contexts, iter.second.element, iter.first, nullptr, false, nullptr, 0.0});
+	}
+
+	LoadStats* stats = options.stats;
+	PhaseTimer timer(stats);
+
+	// a serial load gains nothing from the pre-pass, its arrays are inflated straight into the objects
+	const int thread_count = options.thread_count > 0 ? options.thread_count : GetHardwareThreadCount();
+	const bool is_parallel = options.job_processor || thread_count > 1;
+
+	std::vector<const Element*> elements;
+	elements.reserve(is_parallel ? jobs.size() : 0);
+	for (const ObjectJob& job : jobs)
+	{
+		// lazy geometry inflates its arrays when decoded
+		if (scene->m_options.lazy_geometry && job.element->id == "Geometry") continue;
+		// cached arrays are copied from the cache file
+		if (scene->m_cache.find(job.id, Object::Type::GEOMETRY) || scene->m_cache.find(job.id, Object::Type::ANIMATION_CURVE))
+		{
+			if (stats) ++stats->cached_object_count;
+			continue;
+		}
+		if (is_parallel) elements.push_back(job.element);
+	}
+	scene->m_progress.setPhase(LoadProgress::TOKENIZE, LoadProgress::INFLATE);
+	InflateBuffers inflate_buffers;
+	if (!inflateArrays(scene, elements, &contexts, &inflate_buffers)) return false;
+	timer.end(LoadStats::eInflate);
+
+	scene->m_progress.setPhase(LoadProgress::INFLATE, LoadProgress::OBJECTS);
+	const bool is_constructed = runLoadJobs(scene, parseObjectJob, jobs.data(), (u32)sizeof(ObjectJob), (u32)jobs.size());
+	timer.end(LoadStats::eObjects);
+
+	if (stats) stats->parse_contexts = (u32)contexts.contexts.size();
+	contexts.release();
+
+	bool is_error = false;
+	for (const ObjectJob& job : jobs)
+	{
+		if (job.is_error)
+		{
+			// the first failure in the map order, whatever the thread count
+			if (!is_error) Error::s_message = job.error;
+			is_error = true;
+			continue;
+		}
+
+		Object* obj = job.object;
+		scene->m_object_map[job.id].object = obj;
+		if (!obj) continue;
+
+		obj->index = (int)scene->m_all_objects.size();
+		scene->m_all_objects.push_back(obj);
+		obj->id = job.id;
+
+		if (stats)
+		{
+			++stats->object_count[(int)obj->getType()];
+			stats->object_time[(int)obj->getType()] += job.time;
+		}
+
+		switch (obj->getType())
+		{
+			case Object::Type::MATERIAL: scene->mMaterials.push_back((Material*)obj); break;
+			case Object::Type::CONSTRAINT:
+			case Object::Type::CONSTRAINT_POSITION: scene->mConstraints.push_back((Constraint*)obj); break;
+			case Object::Type::ANIMATION_STACK: scene->m_animation_stacks.push_back((AnimationStack*)obj); break;
+			case Object::Type::MESH: scene->m_meshes.push_back((Mesh*)obj); break;
+			case Object::Type::CAMERA: scene->mCameras.push_back((Camera*)obj); break;
+			case Object::Type::LIGHT: scene->mLights.push_back((Light*)obj); break;
+			case Object::Type::SHADER: scene->m_shaders.push_back((Shader*)obj); break;
+		}
+	}
+	// objects constructed before the failure or the cancellation are kept in the map and released with the scene
+	if (is_error || !is_constructed) return false;
+
+	for (const Scene::Connection& con : scene->m_connections)
+	{
+		Object* parent = findObject(*scene, con.to);
+		Object* child = findObject(*scene, con.from);
+		if (!child) continue;
+		if (!parent) continue;
+
+		PropertyBase *objProperty = parent->mProperties.GetFirst();
+
+		if (Scene::Connection::OBJECT_PROPERTY == con.type)
+		{
+			if (con.property == "LookAtProperty")
+			{
+				printf("test\n");
+			}
+
+			if (Object::Type::ANIMATION_CURVE_NODE != child->getType() 
+				&& Object::Type::NODE_ATTRIBUTE != child->getType() )
+			{
+				while (objProperty)
+				{
+					if (con.property == objProperty->GetName() 
+						&& ePT_object == objProperty->GetPropertyType())
+					{
+						((PropertyObject*) objProperty)->SetPropertyValue(child);
+						break;
+					}
+					objProperty = objProperty->GetNext();
+				}
+			}
+		}
+
+		objProperty = parent->mProperties.GetFirst();
 
 		switch (child->getType())
 		{
@@ -3985,15 +6005,11 @@ static bool parseObjects(const Element& root, Scene* scene)
 
 				}
 
-				while (objProperty)
+				objProperty = parent->mProperties.Find((const char*)con.property.begin, con.property.end - con.property.begin, con.property_hash);
+				if (objProperty && objProperty->IsAnimatable())
 				{
-					if (con.property == objProperty->GetName() && objProperty->IsAnimatable())
-					{
-						AnimationCurveNodeImpl* node = (AnimationCurveNodeImpl*)child;
-						((PropertyAnimatable*)objProperty)->AttachAnimationNode(node);
-						break;
-					}
-					objProperty = objProperty->GetNext();
+					AnimationCurveNodeImpl* node = (AnimationCurveNodeImpl*)child;
+					scene->attachAnimationNode((PropertyAnimatable*)objProperty, node);
 				}
 				break;
 		}
@@ -4120,17 +6136,31 @@ static bool parseObjects(const Element& root, Scene* scene)
 		}
 	}
 
+	timer.end(LoadStats::eLinks);
+
+	scene->m_progress.setPhase(LoadProgress::OBJECTS, 1.0f);
+	const float object_count = (float)scene->m_object_map.size();
+	int object_index = 0;
 	for (auto iter : scene->m_object_map)
 	{
+		if ((++object_index & 255) == 0 && !scene->m_progress.report(object_index / object_count)) return false;
+
 		Object* obj = iter.second.object;
 		if (!obj) continue;
 
 		//
 		obj->Retrieve();
+		if (obj->isNode()) ((Model*)obj)->UpdateStaticTransform();
+		timer.end(LoadStats::eRetrieve);
 
 		if (Object::Type::CLUSTER == obj->getType())
 		{
-			if (!((ClusterImpl*)iter.second.object)->postprocess())
+			ClusterImpl* cluster = (ClusterImpl*)obj;
+			if (scene->m_options.lazy_geometry)
+			{
+				cluster->is_lazy = true;
+			}
+			else if (!cluster->postprocess())
 			{
 				Error::s_message = "Failed to postprocess cluster";
 				return false;
@@ -4140,6 +6170,10 @@ static bool parseObjects(const Element& root, Scene* scene)
 		{
 			((AnimationStackImpl*)iter.second.object)->sortLayers();
 		}
+		else if (Object::Type::ANIMATION_LAYER == obj->getType())
+		{
+			((AnimationLayerImpl*)obj)->buildCurveNodeIndex();
+		}
 		/*
 		else if (Object::Type::LIMB_NODE == obj->getType())
 		{
@@ -4154,6 +6188,8 @@ static bool parseObjects(const Element& root, Scene* scene)
 			((CameraImpl*)obj)->PrepProperties();
 		}
 		*/
+		timer.end(LoadStats::ePostprocess);
+
 		// pre-cache scene models hierarchy
 		if (true == obj->isNode())
 		{
@@ -4172,6 +6208,7 @@ static bool parseObjects(const Element& root, Scene* scene)
 				parent = obj->getParents(idx);
 			}
 		}
+		timer.end(LoadStats::eRetrieve);
 	}
 
 
@@ -4202,45 +6239,31 @@ void Model::AddChild(Model *pChild)
 
 
 
-bool Model::evalLocal(OFBMatrix *result, const OFBVector3& translation, const OFBVector3& rotation, const OFBVector3 &scaling) const
+// the pivots, offsets and pre/post rotations around the animated T, R and S
+//  http://help.autodesk.com/view/FBX/2017/ENU/?guid=__files_GUID_10CDD63C_79C1_4F2D_BB28_AD2BE65A02ED_htm
+void Model::BuildStaticTransform(StaticTransform* st) const
 {
-	//Vec3 scaling = getLocalScaling();
 	OFBVector3 rotation_pivot = RotationPivot;
 	OFBVector3 scaling_pivot = ScalingPivot;
-	OFBVector3 preRotation = { 0.0, 0.0, 0.0 }; // getPreRotation();
-	OFBVector3 postRotation = { 0.0, 0.0, 0.0 }; // getPostRotation();
+	OFBVector3 preRotation = { 0.0, 0.0, 0.0 };
+	OFBVector3 postRotation = { 0.0, 0.0, 0.0 };
 	OFBVector3 rotationOffset = RotationOffset;
 	OFBVector3 scalingOffset = ScalingOffset;
-	OFBRotationOrder rotation_order = OFBRotationOrder::eEULER_XYZ;
-	
-	bool enableRotationDOF = RotationActive;
 
-	if (enableRotationDOF)
+	st->rotation_order = OFBRotationOrder::eEULER_XYZ;
+	if (RotationActive)
 	{
-		rotation_order = RotationOrder;
+		st->rotation_order = RotationOrder;
 		preRotation = PreRotation;
 		postRotation = PostRotation;
 	}
-	
-	OFBMatrix s = makeIdentity();
-	s.m[0] = scaling.x;
-	s.m[5] = scaling.y;
-	s.m[10] = scaling.z;
-
-	OFBMatrix t = makeIdentity();
-	setTranslation(translation, &t);
 
-	OFBMatrix r = getRotationMatrix(rotation, rotation_order);
-
-	// choose between simple and complex calculation way
-
-	if (VectorIsZero(rotation_pivot) && VectorIsZero(scaling_pivot)
+	st->scaling_pivot = scaling_pivot;
+	st->is_simple = VectorIsZero(rotation_pivot) && VectorIsZero(scaling_pivot)
 		&& VectorIsZero(preRotation) && VectorIsZero(postRotation)
-		&& VectorIsZero(rotationOffset) && VectorIsZero(scalingOffset))
-	{
-		*result = t * r * s;
-	}
-	else
+		&& VectorIsZero(rotationOffset) && VectorIsZero(scalingOffset);
+
+	if (!st->is_simple)
 	{
 		OFBMatrix r_pre = getRotationMatrix(preRotation, OFBRotationOrder::eEULER_XYZ);
 		OFBMatrix r_post_inv = getRotationMatrix(-postRotation, OFBRotationOrder::eEULER_ZYX);
@@ -4260,13 +6283,77 @@ bool Model::evalLocal(OFBMatrix *result, const OFBVector3& translation, const OF
 		OFBMatrix s_p = makeIdentity();
 		setTranslation(scaling_pivot, &s_p);
 
-		OFBMatrix s_p_inv = makeIdentity();
-		setTranslation(-scaling_pivot, &s_p_inv);
+		st->pre = r_off * r_p * r_pre;
+		st->post = r_post_inv * r_p_inv * s_off * s_p;
+	}
+}
+
+
+void Model::UpdateStaticTransform()
+{
+	BuildStaticTransform(&mStaticTransform);
+
+	RotationActive.SetModified(false);
+	RotationOrder.SetModified(false);
+	PreRotation.SetModified(false);
+	PostRotation.SetModified(false);
+	RotationOffset.SetModified(false);
+	RotationPivot.SetModified(false);
+	ScalingOffset.SetModified(false);
+	ScalingPivot.SetModified(false);
+
+	mStaticTransform.is_valid = true;
+}
+
 
-		// http://help.autodesk.com/view/FBX/2017/ENU/?guid=__files_GUID_10CDD63C_79C1_4F2D_BB28_AD2BE65A02ED_htm
-		*result = t * r_off * r_p * r_pre * r * r_post_inv * r_p_inv * s_off * s_p * s * s_p_inv;
+bool Model::IsStaticTransformModified() const
+{
+	return RotationActive.Modified() || RotationOrder.Modified()
+		|| PreRotation.Modified() || PostRotation.Modified()
+		|| RotationOffset.Modified() || RotationPivot.Modified()
+		|| ScalingOffset.Modified() || ScalingPivot.Modified();
+}
+
+
+bool Model::evalLocal(OFBMatrix *result, const OFBVector3& translation, const OFBVector3& rotation, const OFBVector3 &scaling) const
+{
+	// baked static part, rebuilt on the fly while its properties are modified
+	StaticTransform modified;
+	const StaticTransform* st = &mStaticTransform;
+	if (!mStaticTransform.is_valid || IsStaticTransformModified())
+	{
+		BuildStaticTransform(&modified);
+		st = &modified;
+	}
+
+	// only the animated T, R and S are built per call
+	OFBMatrix r = getRotationMatrix(rotation, st->rotation_order);
+
+	OFBMatrix s = makeIdentity();
+	s.m[0] = scaling.x;
+	s.m[5] = scaling.y;
+	s.m[10] = scaling.z;
+
+	if (st->is_simple)
+	{
+		OFBMatrix t = makeIdentity();
+		setTranslation(translation, &t);
+		*result = t * r * s;
+	}
+	else
+	{
+		// T * pre only adds the translation, S * S_p_inv only gets a scaled translation
+		OFBMatrix t_pre = st->pre;
+		t_pre.m[12] += translation.x;
+		t_pre.m[13] += translation.y;
+		t_pre.m[14] += translation.z;
+
+		s.m[12] = -scaling.x * st->scaling_pivot.x;
+		s.m[13] = -scaling.y * st->scaling_pivot.y;
+		s.m[14] = -scaling.z * st->scaling_pivot.z;
+
+		*result = t_pre * r * st->post * s;
 	}
-	
 	return true;
 }
 
@@ -4293,11 +6380,14 @@ OFBMatrix Model::getGlobalTransform() const
 Object* Object::resolveObjectLinkReverse(Object::Type type) const
 {
 	u64 id = element.getFirstProperty() ? element.getFirstProperty()->getValue().toU64() : 0;
-	for (auto& connection : scene.m_connections)
+	const u32 *begin, *end;
+	scene.m_connections_from.find(id, begin, end);
+	for (const u32* iter = begin; iter != end; ++iter)
 	{
-		if (connection.from == id && connection.to != 0)
+		const Scene::Connection& connection = scene.m_connections[*iter];
+		if (connection.to != 0)
 		{
-			Object* obj = scene.m_object_map.find(connection.to)->second.object;
+			Object* obj = findObject(scene, connection.to);
 			if (obj && obj->getType() == type) return obj;
 		}
 	}
@@ -4314,11 +6404,14 @@ const IScene& Object::getScene() const
 Object* Object::resolveObjectLink(int idx) const
 {
 	u64 id = element.getFirstProperty() ? element.getFirstProperty()->getValue().toU64() : 0;
-	for (auto& connection : scene.m_connections)
+	const u32 *begin, *end;
+	scene.m_connections_to.find(id, begin, end);
+	for (const u32* iter = begin; iter != end; ++iter)
 	{
-		if (connection.to == id && connection.from != 0)
+		const Scene::Connection& connection = scene.m_connections[*iter];
+		if (connection.from != 0)
 		{
-			Object* obj = scene.m_object_map.find(connection.from)->second.object;
+			Object* obj = findObject(scene, connection.from);
 			if (obj)
 			{
 				if (idx == 0) return obj;
@@ -4333,14 +6426,18 @@ Object* Object::resolveObjectLink(int idx) const
 Object* Object::resolveObjectLink(Object::Type type, const char* property, int idx) const
 {
 	u64 id = element.getFirstProperty() ? element.getFirstProperty()->getValue().toU64() : 0;
-	for (auto& connection : scene.m_connections)
+	const u32 property_hash = property ? hashName(property) : 0;
+	const u32 *begin, *end;
+	scene.m_connections_to.find(id, begin, end);
+	for (const u32* iter = begin; iter != end; ++iter)
 	{
-		if (connection.to == id && connection.from != 0)
+		const Scene::Connection& connection = scene.m_connections[*iter];
+		if (connection.from != 0)
 		{
-			Object* obj = scene.m_object_map.find(connection.from)->second.object;
+			Object* obj = findObject(scene, connection.from);
 			if (obj && obj->getType() == type)
 			{
-				if (property == nullptr || connection.property == property)
+				if (property == nullptr || (connection.property_hash == property_hash && connection.property == property))
 				{
 					if (idx == 0) return obj;
 					--idx;
@@ -4357,11 +6454,14 @@ Object* Object::getParents(int idx) const
 	int counter = 0;
 
 	Object* parent = nullptr;
-	for (auto& connection : scene.m_connections)
+	const u32 *begin, *end;
+	scene.m_connections_from.find(id, begin, end);
+	for (const u32* iter = begin; iter != end; ++iter)
 	{
-		if (Scene::Connection::OBJECT_OBJECT == connection.type && connection.from == id)
+		const Scene::Connection& connection = scene.m_connections[*iter];
+		if (Scene::Connection::OBJECT_OBJECT == connection.type)
 		{
-			Object* obj = scene.m_object_map.find(connection.to)->second.object;
+			Object* obj = findObject(scene, connection.to);
 			if (obj && obj->is_node)
 			{
 				if (counter == idx)
@@ -4381,7 +6481,6 @@ bool Object::Retrieve()
 {
 	int ivalue;
 	double dvalue[4];
-	char temp[64];
 	// 1 - read from a templates
 
 	if (nullptr != node_attribute)
@@ -4396,10 +6495,8 @@ bool Object::Retrieve()
 		{
 			if (prop->id == "P" && prop->first_property)
 			{
-				memset(temp, 0, sizeof(char)* 64);
-				prop->first_property->getValue().toString(temp);
-
-				PropertyBase *objProp = mProperties.Find(temp);
+				const DataView name = prop->first_property->getValue();
+				PropertyBase *objProp = mProperties.Find((const char*)name.begin, name.end - name.begin, hashName(name.begin, name.end));
 
 				if (nullptr != objProp)
 				{
@@ -4438,10 +6535,8 @@ bool Object::Retrieve()
 		Element* prop = props->child;
 		while (prop)
 		{
-			memset(temp, 0, sizeof(char)* 64);
-			prop->first_property->getValue().toString(temp);
-
-			PropertyBase *objProp = mProperties.Find(temp);
+			const DataView name = prop->first_property->getValue();
+			PropertyBase *objProp = mProperties.Find((const char*)name.begin, name.end - name.begin, hashName(name.begin, name.end));
 
 			if (nullptr != objProp)
 			{
@@ -4474,60 +6569,659 @@ bool Object::Retrieve()
 	return true;
 }
 
-IScene* load(const u8* data, int size)
+// everything after the tokenizer, works on scene->m_root_element
+static void countElements(const Element& element, LoadStats* stats)
 {
-	std::unique_ptr<Scene> scene = std::make_unique<Scene>();
-	scene->m_data.resize(size);
-	memcpy(&scene->m_data[0], data, size);
-	OptionalError<Element*> root = tokenize(&scene->m_data[0], size);
-	if (root.isError())
+	for (const Element* child = element.child; child; child = child->sibling)
 	{
-		Error::s_message = "";
-		root = tokenizeText(&scene->m_data[0], size);
-		if (root.isError()) return nullptr;
+		++stats->element_count;
+		for (const Property* prop = child->first_property; prop; prop = prop->next) ++stats->property_count;
+		countElements(*child, stats);
 	}
+}
 
-	scene->m_root_element = root.getValue();
-	assert(scene->m_root_element);
 
-	//if (parseTemplates(*root.getValue()).isError()) return nullptr;
-	if(!parseConnections(*root.getValue(), scene.get())) return nullptr;
-	if(!parseTakes(scene.get())) return nullptr;
-	if(!parseObjects(*root.getValue(), scene.get())) return nullptr;
-	parseGlobalSettings(*root.getValue(), scene.get());
+static bool parseSceneElements(Scene* scene)
+{
+	const Element* root = scene->m_root_element;
+	assert(root);
+
+	LoadStats* stats = scene->m_options.stats;
+	if (stats) countElements(*root, stats);
+	PhaseTimer timer(stats);
+
+	//if (parseTemplates(*root).isError()) return false;
+	if(!parseConnections(*root, scene)) return false;
+	timer.end(LoadStats::eConnections);
+	if(!parseTakes(scene)) return false;
+	timer.end(LoadStats::eTakes);
+	bool is_parsed;
+	{
+		ParseScope scope;
+		is_parsed = parseObjects(*root, scene);
+	}
+	if (!is_parsed) return false;
+	timer.mark = stats ? getStatsTime() : 0.0;
+	parseGlobalSettings(*root, scene);
+	timer.end(LoadStats::eGlobalSettings);
 
-	return scene.release();
+	scene->m_progress.setPhase(0.0f, 1.0f);
+	return scene->m_progress.report(1.0f);
 }
 
 
-const char* getError()
+// reset the stats of a load, returns the start time
+static double beginStats(const LoadOptions& options)
 {
-	return Error::s_message;
+	if (!options.stats) return 0.0;
+	*options.stats = LoadStats();
+	return getStatsTime();
 }
 
-Model *FindModelByLabelName(IScene *pScene, const char *name, const ofbx::Object *pRoot)
+
+static void endStats(const Scene& scene, double start)
 {
+	LoadStats* stats = scene.m_options.stats;
+	if (!stats) return;
 
-	const int objectCount = pScene->getAllObjectCount();
-	const Object *const *pObjects = pScene->getAllObjects();
+	stats->total_time = getStatsTime() - start;
+	if (scene.m_source) stats->source_size = scene.m_source_size;
+	scene.m_allocator.getUsage(&stats->arena_reserved, &stats->arena_used);
 
-	for (int i = 0; i < objectCount; ++i)
+	for (const Object* obj : scene.m_all_objects)
 	{
-		const Object *pObject = pObjects[i];
-
-		if (true == pObject->isNode())
+		if (obj->getType() == Object::Type::GEOMETRY)
 		{
-			if (0 == strcmp(name, pObject->name))
-			{
-				return (Model*)pObject;
-			}
+			const GeometryImpl* geom = (const GeometryImpl*)obj;
+			stats->array_bytes += geom->vertices.capacity() * sizeof(geom->vertices[0])
+				+ geom->normals.capacity() * sizeof(geom->normals[0])
+				+ geom->uvs.capacity() * sizeof(geom->uvs[0])
+				+ geom->colors.capacity() * sizeof(geom->colors[0])
+				+ geom->tangents.capacity() * sizeof(geom->tangents[0])
+				+ geom->vertices_f.capacity() * sizeof(geom->vertices_f[0])
+				+ geom->normals_f.capacity() * sizeof(geom->normals_f[0])
+				+ geom->uvs_f.capacity() * sizeof(geom->uvs_f[0])
+				+ geom->colors_f.capacity() * sizeof(geom->colors_f[0])
+				+ geom->tangents_f.capacity() * sizeof(geom->tangents_f[0])
+				+ (geom->materials.capacity() + geom->to_old_vertices.capacity() + geom->to_new_offsets.capacity()
+					+ geom->to_new_indices.capacity() + geom->indices.capacity()) * sizeof(int);
+		}
+		else if (obj->getType() == Object::Type::ANIMATION_CURVE)
+		{
+			const AnimationCurveImpl* curve = (const AnimationCurveImpl*)obj;
+			stats->array_bytes += curve->times.capacity() * sizeof(curve->times[0])
+				+ curve->values.capacity() * sizeof(curve->values[0])
+				+ curve->flags.capacity() * sizeof(curve->flags[0]);
 		}
 	}
-
-	return nullptr;
 }
 
-bool AnimationStackImpl::sortLayers()
+
+static bool parseScene(Scene* scene, const u8* data, size_t size)
+{
+	// roughly one page per quarter of the source, so small and medium files tokenize into a single page
+	const size_t page_size = size / 4;
+	scene->m_allocator.setPageSize(std::min(std::max(page_size, (size_t)64 * 1024), (size_t)32 * 1024 * 1024));
+
+	PhaseTimer timer(scene->m_options.stats);
+	scene->m_source = data;
+	scene->m_source_size = size;
+	if (scene->m_options.cache_path)
+	{
+		const u64 hash = SceneCache::hashSource(data, size);
+		scene->m_cache.open(scene->m_options.cache_path, hash, size, SceneCache::getFlags(scene->m_options));
+		timer.end(LoadStats::eCache);
+	}
+
+	// an ASCII source gets through the binary tokenizer only until it fails, its progress comes from the text one
+	static const char BINARY_MAGIC[] = "Kaydara FBX Binary  ";
+	const bool is_binary = size >= sizeof(Header) && memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+	LoadProgress* progress = scene->m_progress.callback ? &scene->m_progress : nullptr;
+	scene->m_progress.setPhase(0.0f, LoadProgress::TOKENIZE);
+	OptionalError<Element*> root = tokenize(data, size, scene->m_allocator, is_binary ? progress : nullptr);
+	if (root.isError())
+	{
+		// a binary source keeps the reason of the failure, e.g. out of memory
+		if (is_binary || scene->m_progress.is_cancelled) return false;
+		Error::s_message = "";
+		scene->m_allocator.reset();
+		root = tokenizeText(data, size, scene->m_allocator, progress);
+		if (root.isError()) return false;
+	}
+	timer.end(LoadStats::eTokenize);
+
+	scene->m_root_element = root.getValue();
+	return parseSceneElements(scene);
+}
+
+
+bool Scene::SaveCache(const char* path) const
+{
+	if (!m_source)
+	{
+		Error::s_message = "The scene has no source to key the cache";
+		return false;
+	}
+
+	struct PendingEntry
+	{
+		SceneCache::Entry entry;
+		const void* data[SceneCache::MAX_STREAMS];
+	};
+
+	std::vector<PendingEntry> pending;
+	auto addStream = [](PendingEntry& item, const void* data, size_t size) {
+		SceneCache::Stream& stream = item.entry.streams[item.entry.stream_count];
+		stream.offset = 0;
+		stream.size = size;
+		item.data[item.entry.stream_count] = data;
+		++item.entry.stream_count;
+	};
+	auto addVector = [&addStream](PendingEntry& item, const auto& vec) {
+		addStream(item, vec.empty() ? nullptr : vec.data(), vec.size() * sizeof(vec[0]));
+	};
+
+	for (const Object* obj : m_all_objects)
+	{
+		PendingEntry item;
+		memset(&item, 0, sizeof(item));
+		item.entry.id = obj->id;
+		item.entry.type = (u32)obj->getType();
+
+		if (obj->getType() == Object::Type::GEOMETRY)
+		{
+			const GeometryImpl* geom = (const GeometryImpl*)obj;
+			if (!geom->Prefetch()) continue;
+
+			if (geom->is_float)
+			{
+				addVector(item, geom->vertices_f);
+				addVector(item, geom->normals_f);
+				addVector(item, geom->uvs_f);
+				addVector(item, geom->colors_f);
+				addVector(item, geom->tangents_f);
+			}
+			else
+			{
+				addVector(item, geom->vertices);
+				addVector(item, geom->normals);
+				addVector(item, geom->uvs);
+				addVector(item, geom->colors);
+				addVector(item, geom->tangents);
+			}
+			addVector(item, geom->materials);
+			addVector(item, geom->to_old_vertices);
+			addVector(item, geom->to_new_offsets);
+			addVector(item, geom->to_new_indices);
+			addVector(item, geom->indices);
+		}
+		else if (obj->getType() == Object::Type::ANIMATION_CURVE)
+		{
+			const AnimationCurveImpl* curve = (const AnimationCurveImpl*)obj;
+			addVector(item, curve->times);
+			addVector(item, curve->values);
+			addVector(item, curve->flags);
+		}
+		else
+		{
+			continue;
+		}
+		pending.push_back(item);
+	}
+
+	std::sort(pending.begin(), pending.end(), [](const PendingEntry& a, const PendingEntry& b) { return a.entry.id < b.entry.id; });
+
+	// entry table right after the header, then the streams 16-byte aligned
+	u64 offset = sizeof(SceneCache::FileHeader) + pending.size() * sizeof(SceneCache::Entry);
+	for (PendingEntry& item : pending)
+	{
+		for (u32 i = 0; i < item.entry.stream_count; ++i)
+		{
+			offset = (offset + 15) & ~(u64)15;
+			item.entry.streams[i].offset = offset;
+			offset += item.entry.streams[i].size;
+		}
+	}
+
+	SceneCache::FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SceneCache::magic(), sizeof(header.magic));
+	header.version = SceneCache::VERSION;
+	header.flags = SceneCache::getFlags(m_options);
+	header.source_hash = SceneCache::hashSource(m_source, m_source_size);
+	header.source_size = m_source_size;
+	header.entry_count = pending.size();
+
+	FILE* fp = fopen(path, "wb");
+	if (!fp)
+	{
+		Error::s_message = "Failed to create the cache file";
+		return false;
+	}
+
+	bool is_error = fwrite(&header, sizeof(header), 1, fp) != 1;
+	for (const PendingEntry& item : pending)
+	{
+		if (is_error) break;
+		is_error = fwrite(&item.entry, sizeof(item.entry), 1, fp) != 1;
+	}
+
+	u64 position = sizeof(SceneCache::FileHeader) + pending.size() * sizeof(SceneCache::Entry);
+	static const u8 padding[16] = {};
+	for (const PendingEntry& item : pending)
+	{
+		for (u32 i = 0; i < item.entry.stream_count && !is_error; ++i)
+		{
+			const SceneCache::Stream& stream = item.entry.streams[i];
+			if (stream.offset > position) is_error = fwrite(padding, (size_t)(stream.offset - position), 1, fp) != 1;
+			if (!is_error && stream.size > 0) is_error = fwrite(item.data[i], (size_t)stream.size, 1, fp) != 1;
+			position = stream.offset + stream.size;
+		}
+	}
+
+	if (fclose(fp) != 0) is_error = true;
+	if (is_error)
+	{
+		remove(path);
+		Error::s_message = "Failed to write the cache file";
+		return false;
+	}
+	return true;
+}
+
+
+// buffered reader over LoadStream, offset is the stream position of the next byte
+struct StreamInput
+{
+	StreamInput(const LoadStream& _stream)
+		: stream(_stream)
+		, buffer(64 * 1024)
+	{
+	}
+
+	bool fill()
+	{
+		pos = 0;
+		size = stream.read(&buffer[0], buffer.size(), stream.user_ptr);
+		return size > 0;
+	}
+
+	bool read(void* dst, size_t count)
+	{
+		u8* out = (u8*)dst;
+		while (count > 0)
+		{
+			if (pos == size)
+			{
+				// big payloads go straight to the destination
+				if (count >= buffer.size())
+				{
+					const size_t got = stream.read(out, count, stream.user_ptr);
+					if (got == 0) return false;
+					out += got;
+					count -= got;
+					offset += got;
+					continue;
+				}
+				if (!fill()) return false;
+			}
+			const size_t chunk = std::min(count, size - pos);
+			memcpy(out, &buffer[pos], chunk);
+			pos += chunk;
+			out += chunk;
+			count -= chunk;
+			offset += chunk;
+		}
+		return true;
+	}
+
+	template <typename T> bool read(T* value) { return read(value, sizeof(T)); }
+
+	bool skip(u64 count)
+	{
+		const size_t chunk = (size_t)std::min<u64>(count, size - pos);
+		pos += chunk;
+		offset += chunk;
+		count -= chunk;
+		if (count == 0) return true;
+
+		if (stream.skip)
+		{
+			if (!stream.skip(count, stream.user_ptr)) return false;
+			offset += count;
+			return true;
+		}
+		while (count > 0)
+		{
+			if (!fill()) return false;
+			pos = (size_t)std::min<u64>(count, size);
+			offset += pos;
+			count -= pos;
+		}
+		return true;
+	}
+
+	const LoadStream& stream;
+	std::vector<u8> buffer;
+	size_t pos = 0;
+	size_t size = 0;
+	u64 offset = 0;
+	LoadProgress* progress = nullptr;	// checked once per element
+};
+
+
+static OptionalError<u64> readStreamOffset(StreamInput* input, u32 version)
+{
+	if (version >= 7500)
+	{
+		u64 value;
+		if (!input->read(&value)) return Error("Reading past the end");
+		return value;
+	}
+	u32 value;
+	if (!input->read(&value)) return Error("Reading past the end");
+	return (u64)value;
+}
+
+
+// readProperty() over a stream, every property value gets its own copy in the allocator
+//  end_offset is where the owning element ends, no payload reaches past it
+static OptionalError<Property*> readStreamProperty(StreamInput* input, u64 end_offset, Allocator& allocator)
+{
+	u8 type;
+	if (!input->read(&type)) return Error("Reading past the end");
+
+	// header: the length fields in front of the payload, part of the value except for strings
+	u8 header[12];
+	size_t header_size = 0;
+	u64 payload = 0;
+	switch (type)
+	{
+		case 'S':
+		case 'R': header_size = 4; break;
+		case 'Y': payload = 2; break;
+		case 'C': payload = 1; break;
+		case 'I':
+		case 'F': payload = 4; break;
+		case 'D':
+		case 'L': payload = 8; break;
+		case 'b':
+		case 'c':
+		case 'f':
+		case 'd':
+		case 'l':
+		case 'i': header_size = 12; break;
+		default: return Error("Unknown property type");
+	}
+
+	if (header_size > 0)
+	{
+		if (!input->read(header, header_size)) return Error("Reading past the end");
+		u32 length;
+		memcpy(&length, header + header_size - 4, sizeof(length));
+		payload = length;
+	}
+	if (type == 'S') header_size = 0;
+
+	// the length is not trusted before allocating, the stream can't be measured up front
+	if (payload > INT_MAX || input->offset + payload > end_offset) return Error("Reading past the end");
+
+	u8* data = (u8*)allocator.allocate(header_size + (size_t)payload, 8);
+	if (!data) return Error("Out of memory");
+	memcpy(data, header, header_size);
+	if (!input->read(data + header_size, (size_t)payload)) return Error("Reading past the end");
+
+	Property* prop = allocator.allocate<Property>();
+	if (!prop) return Error("Out of memory");
+	prop->next = nullptr;
+	prop->type = type;
+	prop->value.begin = data;
+	prop->value.end = data + header_size + payload;
+	return prop;
+}
+
+
+// readElement() over a stream, the children of filtered and skipped elements are skipped by the end offset
+static OptionalError<Element*> readStreamElement(StreamInput* input, u32 version, int depth, bool in_objects, const Scene& scene, Allocator& allocator)
+{
+	if (input->progress && !input->progress->update(input->offset, 0)) return Error();
+
+	OptionalError<u64> end_offset = readStreamOffset(input, version);
+	if (end_offset.isError()) return Error();
+	if (end_offset.getValue() == 0) return nullptr;
+
+	OptionalError<u64> prop_count = readStreamOffset(input, version);
+	OptionalError<u64> prop_length = readStreamOffset(input, version);
+	if (prop_count.isError() || prop_length.isError()) return Error();
+
+	u8 id_length;
+	if (!input->read(&id_length)) return Error("Reading past the end");
+	u8* id = (u8*)allocator.allocate(id_length, 1);
+	if (!id) return Error("Out of memory");
+	if (!input->read(id, id_length)) return Error("Reading past the end");
+
+	Element* element = allocator.allocate<Element>();
+	if (!element) return Error("Out of memory");
+	element->first_property = nullptr;
+	element->id.begin = id;
+	element->id.end = id + id_length;
+	element->child = nullptr;
+	element->sibling = nullptr;
+
+	Property** prop_link = &element->first_property;
+	for (u32 i = 0; i < prop_count.getValue(); ++i)
+	{
+		OptionalError<Property*> prop = readStreamProperty(input, end_offset.getValue(), allocator);
+		if (prop.isError()) return Error();
+
+		*prop_link = prop.getValue();
+		prop_link = &(*prop_link)->next;
+	}
+
+	if (input->offset >= end_offset.getValue()) return element;
+
+	const LoadStream& stream = *scene.m_stream;
+	bool keep = !(in_objects && isSkipped(*element, scene.m_options.skip_flags));
+	if (keep && stream.filter) keep = stream.filter(*element, depth, stream.user_ptr);
+	if (!keep)
+	{
+		if (!input->skip(end_offset.getValue() - input->offset)) return Error("Reading past the end");
+		return element;
+	}
+
+	const u64 BLOCK_SENTINEL_LENGTH = version >= 7500 ? 25 : 13;
+	const bool children_in_objects = depth == 0 && element->id == "Objects";
+
+	Element** link = &element->child;
+	while (input->offset + BLOCK_SENTINEL_LENGTH < end_offset.getValue())
+	{
+		OptionalError<Element*> child = readStreamElement(input, version, depth + 1, children_in_objects, scene, allocator);
+		if (child.isError()) return Error();
+
+		if (nullptr != child.getValue())
+		{
+			*link = child.getValue();
+			link = &(*link)->sibling;
+		}
+	}
+
+	if (!input->skip(BLOCK_SENTINEL_LENGTH)) return Error("Reading past the end");
+	return element;
+}
+
+
+static bool parseStream(Scene* scene, const LoadStream& stream)
+{
+	StreamInput input(stream);
+
+	Header header;
+	if (!input.read(&header))
+	{
+		Error::s_message = "Reading past the end";
+		return false;
+	}
+
+	static const char BINARY_MAGIC[] = "Kaydara FBX Binary  ";
+	if (memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)
+	{
+		// ASCII, the text tokenizer needs the whole source
+		scene->m_data.resize(sizeof(header));
+		memcpy(&scene->m_data[0], &header, sizeof(header));
+		for (;;)
+		{
+			const size_t old_size = scene->m_data.size();
+			scene->m_data.resize(old_size + 1024 * 1024);
+			const size_t got = stream.read(&scene->m_data[old_size], 1024 * 1024, stream.user_ptr);
+			scene->m_data.resize(old_size + got);
+			if (got == 0) break;
+		}
+		// the buffered bytes after the header
+		scene->m_data.insert(scene->m_data.begin() + sizeof(header), input.buffer.begin() + input.pos, input.buffer.begin() + input.size);
+		return parseScene(scene, &scene->m_data[0], scene->m_data.size());
+	}
+
+	PhaseTimer timer(scene->m_options.stats);
+	scene->m_allocator.setPageSize(1024 * 1024);
+	scene->m_stream = &stream;
+	scene->m_progress.setPhase(0.0f, LoadProgress::TOKENIZE);
+	if (scene->m_progress.callback) input.progress = &scene->m_progress;
+
+	Element* root = scene->m_allocator.allocate<Element>();
+	if (!root)
+	{
+		scene->m_stream = nullptr;
+		Error::s_message = "Out of memory";
+		return false;
+	}
+	root->first_property = nullptr;
+	root->id.begin = nullptr;
+	root->id.end = nullptr;
+	root->child = nullptr;
+	root->sibling = nullptr;
+
+	Element** element = &root->child;
+	for (;;)
+	{
+		OptionalError<Element*> child = readStreamElement(&input, header.version, 0, false, *scene, scene->m_allocator);
+		if (child.isError())
+		{
+			scene->m_stream = nullptr;
+			return false;
+		}
+		// the footer after the terminating record is not needed
+		if (!child.getValue()) break;
+
+		*element = child.getValue();
+		element = &(*element)->sibling;
+
+		if (stream.section) stream.section(*child.getValue(), stream.user_ptr);
+	}
+	scene->m_stream = nullptr;
+	timer.end(LoadStats::eTokenize);
+	if (scene->m_options.stats) scene->m_options.stats->source_size = input.offset;
+
+	scene->m_root_element = root;
+	return parseSceneElements(scene);
+}
+
+
+IScene* load(const u8* data, int size)
+{
+	return load(data, size, LoadOptions());
+}
+
+IScene* load(const u8* data, int size, const LoadOptions& options)
+{
+	const double start = beginStats(options);
+	std::unique_ptr<Scene> scene = std::make_unique<Scene>();
+	scene->m_options = options;
+	scene->m_progress.init(options);
+
+	const u8* source = data;
+	if (options.copy_data)
+	{
+		scene->m_data.resize(size);
+		memcpy(&scene->m_data[0], data, size);
+		source = &scene->m_data[0];
+	}
+
+	const bool is_parsed = parseScene(scene.get(), source, size);
+	endStats(*scene, start);
+	return is_parsed ? scene.release() : nullptr;
+}
+
+
+IScene* loadFile(const char* path, const LoadOptions& options)
+{
+	const double start = beginStats(options);
+	std::unique_ptr<Scene> scene = std::make_unique<Scene>();
+	scene->m_options = options;
+	scene->m_progress.init(options);
+	// the mapping is owned by the scene, so there is nothing to copy
+	scene->m_options.copy_data = false;
+
+	if (!scene->m_file.Open(path))
+	{
+		Error::s_message = "Failed to open file";
+		endStats(*scene, start);
+		return nullptr;
+	}
+
+	const bool is_parsed = parseScene(scene.get(), scene->m_file.GetData(), scene->m_file.GetSize());
+	endStats(*scene, start);
+	return is_parsed ? scene.release() : nullptr;
+}
+
+
+IScene* loadStream(const LoadStream& stream, const LoadOptions& options)
+{
+	const double start = beginStats(options);
+	if (!stream.read)
+	{
+		Error::s_message = "Invalid stream";
+		return nullptr;
+	}
+
+	std::unique_ptr<Scene> scene = std::make_unique<Scene>();
+	scene->m_options = options;
+	scene->m_progress.init(options);
+	// the tokens point into the scene allocator or m_data
+	scene->m_options.copy_data = false;
+
+	const bool is_parsed = parseStream(scene.get(), stream);
+	endStats(*scene, start);
+	return is_parsed ? scene.release() : nullptr;
+}
+
+
+const char* getError()
+{
+	return Error::s_message;
+}
+
+Model *FindModelByLabelName(IScene *pScene, const char *name, const ofbx::Object *pRoot)
+{
+
+	const int objectCount = pScene->getAllObjectCount();
+	const Object *const *pObjects = pScene->getAllObjects();
+
+	for (int i = 0; i < objectCount; ++i)
+	{
+		const Object *pObject = pObjects[i];
+
+		if (true == pObject->isNode())
+		{
+			if (0 == strcmp(name, pObject->name))
+			{
+				return (Model*)pObject;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+bool AnimationStackImpl::sortLayers()
 {
 	std::sort(begin(mLayers), end(mLayers), [](AnimationLayer *a, AnimationLayer *b)->bool {
 
@@ -4581,6 +7275,271 @@ const AnimationCurveNode *Model::FindAnimationNodeByType(const int typeId, const
 	return nullptr;
 }
 
+/////////////////////////////////////////////////////////////////////
+// EvaluationContext
+
+EvaluationContext::EvaluationContext(const IScene &scene)
+{
+	const int count = scene.getAllObjectCount();
+	const Object *const *objects = scene.getAllObjects();
+
+	mModelSlots.resize(count, -1);
+	mCurveSegments.resize(count, 1);
+
+	int models = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		if (objects[i]->isNode()) mModelSlots[i] = models++;
+	}
+	mModels.resize(models);
+}
+
+void EvaluationContext::SetTime(const OFBTime &time)
+{
+	if (mTime.Get() == time.Get())
+		return;
+
+	mTime.Set(time.Get());
+	mStamp += 1;
+	if (0 == mStamp)
+	{
+		// wrapped around, old stamps could match again
+		for (auto &cache : mModels)
+		{
+			cache.local_stamp = 0;
+			cache.global_stamp = 0;
+		}
+		mStamp = 1;
+	}
+}
+
+bool EvaluationContext::GetCachedMatrix(const Object &model, bool global, OFBMatrix &matrix) const
+{
+	if (model.index < 0 || model.index >= (int)mModelSlots.size() || mModelSlots[model.index] < 0)
+		return false;
+
+	const ModelCache &cache = mModels[mModelSlots[model.index]];
+	if ((global ? cache.global_stamp : cache.local_stamp) != mStamp)
+		return false;
+
+	matrix = global ? cache.global : cache.local;
+	return true;
+}
+
+void EvaluationContext::SetCachedMatrix(const Object &model, bool global, const OFBMatrix &matrix)
+{
+	if (model.index < 0 || model.index >= (int)mModelSlots.size() || mModelSlots[model.index] < 0)
+		return;
+
+	ModelCache &cache = mModels[mModelSlots[model.index]];
+	if (global)
+	{
+		cache.global = matrix;
+		cache.global_stamp = mStamp;
+	}
+	else
+	{
+		cache.local = matrix;
+		cache.local_stamp = mStamp;
+	}
+}
+
+u32 *EvaluationContext::GetCurveSegment(const Object &curve)
+{
+	if (curve.index < 0 || curve.index >= (int)mCurveSegments.size())
+		return nullptr;
+	return &mCurveSegments[curve.index];
+}
+
+/////////////////////////////////////////////////////////////////////
+// ScenePose
+
+ScenePose::ScenePose(const IScene &scene)
+	: mScene(scene)
+	, mContext(scene)
+{
+	const int count = scene.getAllObjectCount();
+	const Object *const *objects = scene.getAllObjects();
+
+	// depth of every model in the hierarchy
+	std::vector<int> depths(count, -1);
+	for (int i = 0; i < count; ++i)
+	{
+		if (!objects[i]->isNode()) continue;
+
+		int depth = 0;
+		for (const Model *pParent = ((const Model*)objects[i])->Parent(); nullptr != pParent && depth < count; pParent = pParent->Parent())
+		{
+			depth += 1;
+		}
+		depths[i] = depth;
+	}
+
+	std::vector<int> order;
+	for (int i = 0; i < count; ++i)
+	{
+		if (depths[i] >= 0) order.push_back(i);
+	}
+	// parents first, the scene order is kept between models of the same depth
+	std::stable_sort(order.begin(), order.end(), [&depths](int a, int b) { return depths[a] < depths[b]; });
+
+	mSlots.resize(count, -1);
+	mModels.reserve(order.size());
+	for (int i : order)
+	{
+		mSlots[i] = (int)mModels.size();
+		mModels.push_back((const Model*)objects[i]);
+	}
+
+	mParents.resize(mModels.size(), -1);
+	for (size_t i = 0; i < mModels.size(); ++i)
+	{
+		const Model *pParent = mModels[i]->Parent();
+		if (nullptr != pParent) mParents[i] = FindModelIndex(pParent);
+	}
+
+	mLocal.resize(mModels.size());
+	mGlobal.resize(mModels.size());
+}
+
+int ScenePose::FindModelIndex(const Model *pModel) const
+{
+	if (nullptr == pModel || pModel->index < 0 || pModel->index >= (int)mSlots.size())
+		return -1;
+	return mSlots[pModel->index];
+}
+
+void ScenePose::Evaluate(const OFBTime &time)
+{
+	mContext.SetTime(time);
+	Evaluate(mContext);
+}
+
+void ScenePose::Evaluate(EvaluationContext &context)
+{
+	Evaluate(context, mLocal.data(), mGlobal.data());
+}
+
+void ScenePose::Evaluate(EvaluationContext &context, OFBMatrix *pLocal, OFBMatrix *pGlobal) const
+{
+	for (size_t i = 0, count = mModels.size(); i < count; ++i)
+	{
+		mModels[i]->GetMatrix(pLocal[i], context, eModelTransformation, false);
+
+		const int parent = mParents[i];
+		if (parent >= 0)
+			MatrixMult(pGlobal[i], pGlobal[parent], pLocal[i]);
+		else
+			pGlobal[i] = pLocal[i];
+	}
+}
+
+void ScenePose::ExportGlobalMatrices(float *pMatrices) const
+{
+	for (const OFBMatrix &matrix : mGlobal)
+	{
+		for (int k = 0; k < 16; ++k)
+			pMatrices[k] = (float)matrix.m[k];
+		pMatrices += 16;
+	}
+}
+
+// a run of consecutive frames baked by one worker
+struct PoseBakeJob
+{
+	const ScenePose *pose;
+	const IScene *scene;
+	const i64 *times;
+	int first;
+	int count;
+	float *out;
+};
+
+static void bakePoseJob(void *data)
+{
+	PoseBakeJob *job = (PoseBakeJob*)data;
+	const ScenePose &pose = *job->pose;
+	const int model_count = pose.GetModelCount();
+
+	EvaluationContext context(*job->scene);
+	std::vector<OFBMatrix> local(model_count);
+	std::vector<OFBMatrix> global(model_count);
+
+	for (int frame = job->first, last = job->first + job->count; frame < last; ++frame)
+	{
+		context.SetTime(OFBTime(job->times[frame]));
+		pose.Evaluate(context, local.data(), global.data());
+
+		float *dst = job->out + (size_t)frame * model_count * 16;
+		for (const OFBMatrix &matrix : global)
+		{
+			for (int k = 0; k < 16; ++k)
+				dst[k] = (float)matrix.m[k];
+			dst += 16;
+		}
+	}
+}
+
+void ScenePose::Bake(const i64 *times, int frame_count, float *pMatrices, int thread_count, JobProcessor processor, void *user_ptr) const
+{
+	if (frame_count <= 0 || nullptr == pMatrices)
+		return;
+
+	if (nullptr == processor && thread_count <= 0)
+		thread_count = GetHardwareThreadCount();
+
+	// a few runs per thread for balance, a context per run keeps the curve hints of consecutive frames
+	const int job_count = std::min(frame_count, std::max(1, thread_count) * 4);
+	std::vector<PoseBakeJob> jobs(job_count);
+	for (int i = 0; i < job_count; ++i)
+	{
+		const int first = (int)((i64)frame_count * i / job_count);
+		const int last = (int)((i64)frame_count * (i + 1) / job_count);
+		jobs[i] = { this, &mScene, times, first, last - first, pMatrices };
+	}
+
+	RunJobs(bakePoseJob, jobs.data(), (u32)sizeof(PoseBakeJob), (u32)jobs.size(), thread_count, processor, user_ptr);
+}
+
+void ScenePose::Bake(i64 start, i64 step, int frame_count, float *pMatrices, int thread_count, JobProcessor processor, void *user_ptr) const
+{
+	if (frame_count <= 0)
+		return;
+
+	std::vector<i64> times(frame_count);
+	for (int i = 0; i < frame_count; ++i)
+		times[i] = start + step * i;
+
+	Bake(times.data(), frame_count, pMatrices, thread_count, processor, user_ptr);
+}
+
+int ScenePose::GetTakeFrameCount(const TakeInfo &take, double frame_rate)
+{
+	if (frame_rate <= 0.0 || take.local_time_to < take.local_time_from)
+		return 0;
+	// whole frames inside the range, the epsilon only absorbs the rounding of the seconds
+	return (int)floor((take.local_time_to - take.local_time_from) * frame_rate + 1e-6) + 1;
+}
+
+int ScenePose::BakeTake(const TakeInfo &take, double frame_rate, float *pMatrices, int thread_count, JobProcessor processor, void *user_ptr) const
+{
+	const int frame_count = GetTakeFrameCount(take, frame_rate);
+	if (nullptr == pMatrices || 0 == frame_count)
+		return frame_count;
+
+	// each frame time from the seconds, so the frame step rounding doesn't accumulate,
+	//  and never past the end of the range
+	std::vector<i64> times(frame_count);
+	for (int i = 0; i < frame_count; ++i)
+		times[i] = secondsToFbxTime(std::min(take.local_time_from + i / frame_rate, take.local_time_to));
+
+	Bake(times.data(), frame_count, pMatrices, thread_count, processor, user_ptr);
+	return frame_count;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Model
+
 void Model::GetMatrix(OFBMatrix &pMatrix, ModelTransformationType pWhat, bool pGlobalInfo, const OFBTime *pTime) const
 {
 	OFBTime lTime((nullptr != pTime) ? pTime->Get() : gDisplayInfo.localTime.Get());
@@ -4668,6 +7627,76 @@ void Model::GetRotation(OFBVector4 &pQuat, const OFBTime *pTime) const
 	pQuat.z *= -1.0;
 }
 
+void Model::GetMatrix(OFBMatrix &pMatrix, EvaluationContext &context, ModelTransformationType pWhat, bool pGlobalInfo) const
+{
+	if (context.GetCachedMatrix(*this, pGlobalInfo, pMatrix))
+		return;
+
+	OFBMatrix local;
+	if (!context.GetCachedMatrix(*this, false, local))
+	{
+		OFBVector3	t, r, s;
+
+		Translation.GetData(&t.x, sizeof(OFBVector3), context);
+		Rotation.GetData(&r.x, sizeof(OFBVector3), context);
+		Scaling.GetData(&s.x, sizeof(OFBVector3), context);
+
+		evalLocal(&local, t, r, s);
+		context.SetCachedMatrix(*this, false, local);
+	}
+
+	if (false == pGlobalInfo)
+	{
+		pMatrix = local;
+		return;
+	}
+
+	if (nullptr != mParent)
+	{
+		OFBMatrix parentTM;
+		mParent->GetMatrix(parentTM, context, eModelTransformation, true);
+		MatrixMult(pMatrix, parentTM, local);
+	}
+	else
+	{
+		pMatrix = local;
+	}
+	context.SetCachedMatrix(*this, true, pMatrix);
+}
+
+void Model::GetVector(OFBVector3 &pVector, EvaluationContext &context, ModelTransformationType pWhat, bool pGlobalInfo) const
+{
+	if (true == pGlobalInfo)
+	{
+		OFBMatrix temp;
+		GetMatrix(temp, context, eModelTransformation, pGlobalInfo);
+
+		if (eModelTranslation == pWhat)
+		{
+			pVector.x = temp.m[12];
+			pVector.y = temp.m[13];
+			pVector.z = temp.m[14];
+		}
+		else if (eModelRotation == pWhat)
+		{
+			pVector = Vector_Zero();
+		}
+		else if (eModelScaling == pWhat)
+		{
+			pVector = MatrixGetScale(temp);
+		}
+	}
+	else
+	{
+		if (eModelTranslation == pWhat)
+			Translation.GetData(&pVector.x, sizeof(OFBVector3), context);
+		else if (eModelRotation == pWhat)
+			Rotation.GetData(&pVector.x, sizeof(OFBVector3), context);
+		else if (eModelScaling == pWhat)
+			Scaling.GetData(&pVector.x, sizeof(OFBVector3), context);
+	}
+}
+
 bool Model::IsVisible(const OFBTime *pTime)
 {
 	bool vis = true;
@@ -15,6 +15,7 @@
 #include "OFBMath.h"
 #include "OFBProperty.h"
 #include "OFBRenderer.h"
+#include "OFBJobs.h"
 
 namespace ofbx
 {
@@ -344,6 +345,7 @@ struct Object
 	}
 
 	u64 id;
+	int index = -1;		// position in IScene::getAllObjects(), a dense key for per-object tables
 	char name[128];
 	const IElement& element;
 	const Object* node_attribute;	// contains some specified class properties ontop of base class
@@ -487,6 +489,55 @@ struct NodeAttribute : Object
 	virtual DataView getAttributeType() const = 0;
 };
 
+/////////////////////////////////////////////////////////////////////////////////////////////
+// VertexLayout
+
+//! Geometry streams which can be written by Geometry::WriteVertices.
+enum OFBVertexAttribute
+{
+	eVertexPosition,
+	eVertexNormal,
+	eVertexUV,
+	eVertexColor,
+	eVertexTangent,
+	eVertexAttributeCount
+};
+
+//! Component format of a vertex attribute.
+enum OFBVertexFormat
+{
+	eVertexFloat32,		//!< 32-bit float.
+	eVertexFloat16,		//!< IEEE half float.
+	eVertexSNorm16,		//!< Signed 16-bit, [-1, 1] maps to [-32767, 32767].
+	eVertexUNorm16,		//!< Unsigned 16-bit, [0, 1] maps to [0, 65535].
+	eVertexSNorm8,		//!< Signed 8-bit, [-1, 1] maps to [-127, 127].
+	eVertexUNorm8		//!< Unsigned 8-bit, [0, 1] maps to [0, 255].
+};
+
+// byte layout of one interleaved vertex
+struct VertexLayout
+{
+	struct Attribute
+	{
+		OFBVertexAttribute	attribute;
+		OFBVertexFormat		format;
+		int					components;	// 1 - 4
+		u32					offset;		// bytes from the vertex start
+	};
+
+	Attribute	attributes[eVertexAttributeCount];
+	int			count = 0;
+
+	// append an attribute at the offset, or right after the previous one when offset is -1
+	//  an unknown attribute or a full layout is ignored
+	VertexLayout& Add(OFBVertexAttribute attribute, OFBVertexFormat format, int components, int offset = -1);
+
+	// bytes up to the end of the last attribute, the tightly packed stride
+	u32 GetSize() const;
+
+	static u32 GetFormatSize(OFBVertexFormat format);
+};
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 // Geometry
 
@@ -496,6 +547,9 @@ struct Geometry : Object
 
 	Geometry(const Scene& _scene, const IElement& _element);
 
+	// double precision streams, with LoadOptions::float_geometry the first call of any of them converts all the streams
+	//  and the doubles then stay next to the floats until the scene is destroyed. The float accessors, WriteVertices()
+	//  and OFBSkinDeformer read the float storage directly and keep the memory saving
 	virtual const OFBVector3* getVertices() const = 0;
 	virtual int getVertexCount() const = 0;
 
@@ -505,6 +559,40 @@ struct Geometry : Object
 	virtual const OFBVector3* getTangents() const = 0;
 	virtual const Skin* getSkin() const = 0;
 	virtual const int* getMaterials() const = 0;
+
+	// single precision streams, stored by the scene with LoadOptions::float_geometry
+	//  the streams of the other precision are converted once, on their first access
+	virtual bool isFloatStorage() const = 0;
+	virtual const OFBVector3f* getFloatVertices() const = 0;
+	virtual const OFBVector3f* getFloatNormals() const = 0;
+	virtual const OFBVector2f* getFloatUVs() const = 0;
+	virtual const OFBVector4f* getFloatColors() const = 0;
+	virtual const OFBVector3f* getFloatTangents() const = 0;
+
+	// control points (the source Vertices) to the triangulated vertices of getVertices()
+	//  the vertices of the control point i are getControlPointVertexIndices()[offsets[i] .. offsets[i + 1] - 1]
+	//  with offsets = getControlPointOffsets() (getControlPointCount() + 1 entries), empty for an unused control point
+	virtual int getControlPointCount() const = 0;
+	virtual const int* getControlPointOffsets() const = 0;
+	virtual const int* getControlPointVertexIndices() const = 0;
+	// control point of every vertex, getVertexCount() entries
+	virtual const int* getVertexControlPoints() const = 0;
+
+	// triangle list indices into the vertex streams when the scene was loaded with LoadOptions::weld_vertices,
+	//  otherwise nullptr and 0, the streams are then a triangle soup of getVertexCount() / 3 triangles
+	virtual const int* getIndices() const = 0;
+	virtual int getIndexCount() const = 0;
+
+	// write getVertexCount() vertices of the layout to dst, stride bytes apart (0 - layout.GetSize())
+	//  components the stream doesn't have are 0, except the w of a position and the alpha of a color which are 1,
+	//  a missing stream is written as zeroes (colors as white). The normalized formats clamp the value first
+	//  returns the number of written vertices
+	int WriteVertices(const VertexLayout& layout, void* dst, size_t stride = 0) const;
+
+	// decode the mesh data now, a no-op unless the scene was loaded with LoadOptions::lazy_geometry
+	//  returns false when the geometry data is invalid, getError() on the calling thread has the reason,
+	//  the decode runs once and every later call returns the same result and reason
+	virtual bool Prefetch() const = 0;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
@@ -584,6 +672,10 @@ struct Model : Object
 	void GetVector(OFBVector3 &pVector, ModelTransformationType pWhat = eModelTranslation, bool pGlobalInfo = true, const OFBTime *pTime = nullptr) const;
 	void GetRotation(OFBVector4 &pQuat, const OFBTime *pTime = nullptr) const;
 
+	// thread-safe evaluation at the context time, matrices are cached in the context instead of the model
+	void GetMatrix(OFBMatrix &pMatrix, EvaluationContext &context, ModelTransformationType pWhat = eModelTransformation, bool pGlobalInfo = true) const;
+	void GetVector(OFBVector3 &pVector, EvaluationContext &context, ModelTransformationType pWhat = eModelTranslation, bool pGlobalInfo = true) const;
+
 	/** If the model is visible.
 	*	Note. this query will consider self Visibility property, plus parent node/set Visibility.
 	*   The visibility of a model is affected by 4 parameters:
@@ -601,9 +693,30 @@ struct Model : Object
 
 	std::vector<AnimationCurveNode*>		mAnimationNodes;
 
+	// bake the static part of the local transform (pivots, offsets, pre/post rotation, rotation order)
+	//  done once after the load, call again after changing those properties
+	//  until then evalLocal() rebuilds the static part on every call
+	void UpdateStaticTransform();
+
 protected:
 
 	bool evalLocal(OFBMatrix *result, const OFBVector3& translation, const OFBVector3& rotation, const OFBVector3 &scaling) const;
+	bool IsStaticTransformModified() const;
+
+	// local = (T * pre) * R * post * (S * S_p_inv) for the complex case, T * R * S for the simple one
+	struct StaticTransform
+	{
+		OFBMatrix			pre;				// r_off * r_p * r_pre
+		OFBMatrix			post;				// r_post_inv * r_p_inv * s_off * s_p
+		OFBVector3			scaling_pivot;
+		OFBRotationOrder	rotation_order = OFBRotationOrder::eEULER_XYZ;
+		bool				is_simple = true;	// no pivots, offsets and pre/post rotations
+		bool				is_valid = false;
+	};
+
+	void BuildStaticTransform(StaticTransform* st) const;
+
+	StaticTransform		mStaticTransform;
 
 	//
 	OFBMatrix			mGlobalCache;
@@ -754,6 +867,9 @@ struct Camera : Model
 
 	virtual bool GetCameraMatrix(float *pMatrix, CameraMatrixType pType, const OFBTime *pTime = nullptr) = 0;
 	virtual bool GetCameraMatrix(double *pMatrix, CameraMatrixType pType, const OFBTime *pTime = nullptr) = 0;
+	// thread-safe variant, computed at the context time every call, SetCameraMatrix overrides are ignored
+	virtual bool GetCameraMatrix(float *pMatrix, CameraMatrixType pType, EvaluationContext &context) const = 0;
+	virtual bool GetCameraMatrix(double *pMatrix, CameraMatrixType pType, EvaluationContext &context) const = 0;
 
 	// override camera matrix
 	virtual void SetCameraMatrix(const float *pMatrix, CameraMatrixType pType) = 0;
@@ -823,13 +939,46 @@ struct ConstraintPosition : Constraint
 
 };
 
-// info for the one evaluation task
-struct EvaluationInfo
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// EvaluationContext
+
+// time and caches of one evaluation thread
+//  the context overloads of GetData/Evaluate/GetMatrix/GetVector/GetCameraMatrix only read the scene
+//  and keep their state here, so every thread can evaluate the same scene with its own context
+struct EvaluationContext
 {
-	OFBTime		localTime;
-	OFBTime		systemTime;
+	//! a constructor
+	explicit EvaluationContext(const IScene &scene);
+
+	// switching the time drops the cached matrices
+	void SetTime(const OFBTime &time);
+	const OFBTime &GetTime() const {
+		return mTime;
+	}
+
+	// model matrix cache of the current time
+	bool GetCachedMatrix(const Object &model, bool global, OFBMatrix &matrix) const;
+	void SetCachedMatrix(const Object &model, bool global, const OFBMatrix &matrix);
+
+	// last key segment of a curve, a hint for the next evaluation
+	u32 *GetCurveSegment(const Object &curve);
 
-	bool		IsStop;	// is playing or not
+protected:
+
+	struct ModelCache
+	{
+		OFBMatrix	local;
+		OFBMatrix	global;
+		u32			local_stamp = 0;
+		u32			global_stamp = 0;
+	};
+
+	OFBTime						mTime;
+	u32							mStamp = 1;		// cache entries of the current time carry this stamp
+
+	std::vector<int>			mModelSlots;	// Object::index -> mModels, -1 for non model objects
+	std::vector<ModelCache>		mModels;
+	std::vector<u32>			mCurveSegments;	// by Object::index
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -891,6 +1040,13 @@ struct AnimationCurve : Object
 	virtual const int *getKeyFlag() const = 0;
 
 	virtual double Evaluate(const OFBTime &time) const = 0;
+	// thread-safe evaluation at the context time, the key segment hint is kept in the context
+	virtual double Evaluate(EvaluationContext &context) const = 0;
+
+	// sample the curve at start + i * step for i in [0, count) into out, same values as Evaluate()
+	//  keys are walked once for a non-negative step, the evaluation cache is not touched
+	virtual void EvaluateRange(i64 start, i64 step, int count, float *out) const = 0;
+	virtual void EvaluateRange(i64 start, i64 step, int count, double *out) const = 0;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -916,6 +1072,7 @@ struct AnimationCurveNode : Object
 	virtual const AnimationCurve *getCurve(int index) const = 0;
 
 	virtual bool Evaluate(double *Data, const OFBTime pTime) const = 0;
+	virtual bool Evaluate(double *Data, EvaluationContext &context) const = 0;
 };
 
 
@@ -965,16 +1122,223 @@ struct IScene
 	// we should prep properties animation nodes for a current take (Stack)
 	virtual bool PrepTakeConnections(const int takeIndex) = 0;
 
+	// write the decoded geometry and animation curve arrays for LoadOptions::cache_path,
+	//  lazy geometry is decoded first. A scene streamed from a binary LoadStream has no source to key the cache
+	virtual bool SaveCache(const char* path) const = 0;
+
 protected:
 	virtual ~IScene() {}
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////
-// global functions
+// ScenePose
+
+// every model of a scene sorted parents first, the whole hierarchy is evaluated in one pass
+//  into contiguous local and global matrix arrays, each global reuses the already computed parent one
+struct ScenePose
+{
+	//! a constructor
+	explicit ScenePose(const IScene &scene);
+
+	int GetModelCount() const {
+		return (int)mModels.size();
+	}
+	const Model *GetModel(int index) const {
+		return mModels[index];
+	}
+	// pose index of the parent model, -1 for a root
+	int GetParentIndex(int index) const {
+		return mParents[index];
+	}
+	// pose index of the model, -1 when it's not part of the pose
+	int FindModelIndex(const Model *pModel) const;
+
+	// evaluate at the time, uses the pose own context so no model cache is written
+	void Evaluate(const OFBTime &time);
+	// evaluate at the context time, one pose per thread
+	void Evaluate(EvaluationContext &context);
+	// evaluate at the context time into external arrays of GetModelCount() matrices
+	void Evaluate(EvaluationContext &context, OFBMatrix *pLocal, OFBMatrix *pGlobal) const;
+
+	const OFBMatrix *GetLocalMatrices() const {
+		return mLocal.data();
+	}
+	const OFBMatrix *GetGlobalMatrices() const {
+		return mGlobal.data();
+	}
+
+	// 16 floats per model in pose order, e.g. to fill a gpu buffer
+	void ExportGlobalMatrices(float *pMatrices) const;
+
+	// bake the global matrices of every frame into pMatrices[frame][model][16] (frame_count * GetModelCount() * 16 floats)
+	//  frames are spread over thread_count threads (1 - the calling thread, 0 - every hardware thread, as LoadOptions) or the job processor,
+	//  each worker evaluates with its own context, the pose itself and the models are not modified
+	void Bake(const i64 *times, int frame_count, float *pMatrices, int thread_count = 1, JobProcessor processor = nullptr, void *user_ptr = nullptr) const;
+	// frames start + i * step
+	void Bake(i64 start, i64 step, int frame_count, float *pMatrices, int thread_count = 1, JobProcessor processor = nullptr, void *user_ptr = nullptr) const;
+	// every frame of the take local range at the frame rate, returns the number of frames written
+	//  pass nullptr to query the frame count only
+	int BakeTake(const TakeInfo &take, double frame_rate, float *pMatrices, int thread_count = 1, JobProcessor processor = nullptr, void *user_ptr = nullptr) const;
+
+	// number of frames of the take local range at the frame rate, the last one is at or before the range end
+	static int GetTakeFrameCount(const TakeInfo &take, double frame_rate);
 
-EvaluationInfo &GetDisplayInfo();
+protected:
+
+	const IScene				&mScene;
+
+	std::vector<const Model*>	mModels;
+	std::vector<int>			mParents;
+	std::vector<int>			mSlots;		// Object::index -> pose index
+
+	std::vector<OFBMatrix>		mLocal;
+	std::vector<OFBMatrix>		mGlobal;
+
+	EvaluationContext			mContext;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////
+// LoadOptions
+
+// LoadOptions::skip_flags, object classes which are never turned into objects
+enum OFBLoadSkipFlags
+{
+	eSkipNone = 0,
+	eSkipGeometry = 1 << 0,		//!< Geometry and the skin deformers (Skin, Cluster) bound to it.
+	eSkipTextures = 1 << 1,		//!< Texture and Video.
+	eSkipConstraints = 1 << 2,	//!< Constraint.
+	eSkipAnimation = 1 << 3		//!< AnimationStack, AnimationLayer, AnimationCurveNode and AnimationCurve.
+};
+
+////////////////////////////////////////////////////////////////////////////////////////
+// LoadStats
+
+// profile of one load, filled when LoadOptions::stats is set. Times are wall clock milliseconds
+struct LoadStats
+{
+	enum Phase
+	{
+		eCache,				// source hash and the LoadOptions::cache_path validation
+		eTokenize,			// token tree, for loadStream() it includes reading the stream
+		eConnections,
+		eTakes,
+		eInflate,			// compressed arrays pre-pass, only parallel loads have one
+		eObjects,			// object construction, parseGeometry, parseAnimationCurve, ...
+		eLinks,				// connections resolved into the objects
+		eRetrieve,			// property values, static transforms and the model hierarchy
+		ePostprocess,		// skin cluster remap, layer sorting and curve node indices
+		eGlobalSettings,
+		ePhaseCount
+	};
+
+	enum { OBJECT_TYPE_COUNT = (int)Object::Type::ANIMATION_CURVE_NODE + 1 };
+
+	double total_time = 0.0;
+	double phase_time[ePhaseCount] = {};
+
+	u64 source_size = 0;
+	u64 bytes_inflated = 0;			// decompressed bytes of the inflate pre-pass of a parallel load, a serial load and lazy geometry inflate in place
+	u32 arrays_inflated = 0;
+	u32 element_count = 0;
+	u32 property_count = 0;
+
+	// objects by Object::Type, the construction time is summed over the threads
+	u32 object_count[OBJECT_TYPE_COUNT] = {};
+	double object_time[OBJECT_TYPE_COUNT] = {};
+	u32 cached_object_count = 0;	// geometry and curves with arrays from LoadOptions::cache_path
+	// scratch buffer sets of the inflate and object jobs, one per job running at the same time, the next jobs reuse them
+	u32 parse_contexts = 0;
+
+	// the token tree arena only grows during a load, so the reserved size is also its peak
+	u64 arena_reserved = 0;
+	u64 arena_used = 0;
+	// heap held by the decoded geometry and animation curve arrays at the end of the load
+	u64 array_bytes = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////
+// LoadOptions
+
+struct LoadOptions
+{
+	// when true (default) the source buffer is copied into the scene.
+	// when false the scene tokenizes the caller buffer in place, every DataView, IElement and IElementProperty
+	//  points straight into it, so the buffer must stay valid and unchanged until IScene::destroy()
+	bool copy_data = true;
+
+	// objects (geometry, curves, materials, ...) are constructed on up to thread_count threads,
+	//  1 keeps the load on the calling thread, 0 or less uses every hardware thread.
+	//  connections and Retrieve() always run afterwards, serially and in a deterministic order
+	int thread_count = 1;
+	// optional external job system, replaces the built-in threads when set,
+	//  the jobs borrow the parsing scratch buffers from the load, so its threads keep nothing afterwards
+	JobProcessor job_processor = nullptr;
+	void* job_user_ptr = nullptr;
+
+	// when true geometry is only validated during the load, vertices, normals, uvs, ... and the skin
+	//  cluster remap are decoded on the first access of the data or on Geometry::Prefetch()
+	bool lazy_geometry = false;
+
+	// when true geometry corners with the same control point, normal, uv, color and tangent share one vertex,
+	//  Geometry::getIndices() then holds the triangle list and the vertex streams are compact
+	bool weld_vertices = false;
+
+	// when true geometry streams (vertices, normals, uvs, colors, tangents) are stored in single precision,
+	//  the float accessors of Geometry read them directly, the double ones convert on the first call and keep both copies
+	bool float_geometry = false;
+
+	// OFBLoadSkipFlags combination, skipped elements stay in the token tree but get no object,
+	//  their arrays are never decompressed and connections to them are ignored
+	u32 skip_flags = eSkipNone;
+	// when set, only the animation stack of that name with its layers, curve nodes and curves is loaded
+	const char* animation_stack = nullptr;
+
+	// file written by IScene::SaveCache(), it's used when it was saved for the same source bytes, weld_vertices
+	//  and float_geometry, then geometry and curve arrays are copied from it instead of being inflated and decoded.
+	//  the source is still hashed, tokenized and its objects, connections and properties are built as usual
+	const char* cache_path = nullptr;
+
+	// optional profile of the load, it's reset at the start of the load and filled even when the load fails
+	LoadStats* stats = nullptr;
+
+	// optional progress of the load in [0, 1], called on the loading thread while the source is tokenized
+	//  and between its own inflate and object jobs. Returning false cancels the load, it then returns nullptr
+	//  and getError() is "Load cancelled". A binary LoadStream has no known size, it reports 0 until it's read
+	bool (*progress)(float fraction, void* user_ptr) = nullptr;
+	void* progress_user_ptr = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////
+// LoadStream
+
+// chunked source of loadStream()
+struct LoadStream
+{
+	// read up to size bytes into buffer, returns the number of bytes read, 0 at the end of the stream or on a failure
+	size_t (*read)(void* buffer, size_t size, void* user_ptr) = nullptr;
+	// optional, move size bytes forward without reading them, the bytes are read and dropped when not set
+	bool (*skip)(u64 size, void* user_ptr) = nullptr;
+
+	// optional filter of a binary stream, called once the element id and properties are read (depth 0 is a top-level section)
+	//  returning false drops the element children, their bytes are skipped and never kept
+	bool (*filter)(const IElement& element, int depth, void* user_ptr) = nullptr;
+	// optional, called for every completed top-level section (Definitions, Objects, Connections, Takes, ...)
+	void (*section)(const IElement& element, void* user_ptr) = nullptr;
+
+	void* user_ptr = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////
+// global functions
 
 IScene* load(const u8* data, int size);
+IScene* load(const u8* data, int size, const LoadOptions& options);
+// memory-map the file and tokenize directly off the mapping, the mapping lives as long as the scene
+IScene* loadFile(const char* path, const LoadOptions& options = LoadOptions());
+// a binary stream is tokenized element by element while it is read, only the kept elements stay in memory
+//  and the subtrees of objects skipped by LoadOptions::skip_flags are never read. An ASCII stream is read whole first
+IScene* loadStream(const LoadStream& stream, const LoadOptions& options = LoadOptions());
+// reason of the last failure on the calling thread, loads on different threads don't share it
 const char* getError();
 
 Model *FindModelByLabelName(IScene *pScene, const char *name, const ofbx::Object *pRoot=nullptr);
@@ -0,0 +1,234 @@
+// main.cpp
+//
+// Sergei <Neill3d> Solokhin (https://github.com/Neill3d/OpenFBX)
+//
+// regression tests of the loader and the evaluation, returns the number of failed checks
+
+#include "ofbx.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace ofbx;
+
+static int gFailed = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); ++gFailed; } } while (0)
+
+///////////////////////////////////////////////////////////////////////////////////
+// scenes
+
+// two takes, the model is animated by the second one only
+static const char *TWO_TAKES_SCENE =
+	"; FBX 7.4.0 project file\n"
+	"FBXHeaderExtension: {\n"
+	"	FBXHeaderVersion: 1003\n"
+	"	FBXVersion: 7400\n"
+	"}\n"
+	"Objects: {\n"
+	"	AnimationStack: 1000, \"AnimStack::Take 001\", \"\"\n"
+	"	AnimationLayer: 1001, \"AnimLayer::BaseLayer\", \"\"\n"
+	"	AnimationStack: 1002, \"AnimStack::Take 002\", \"\"\n"
+	"	AnimationLayer: 1003, \"AnimLayer::BaseLayer\", \"\"\n"
+	"	Model: 1004, \"Model::animated\", \"Null\" {\n"
+	"		Version: 232\n"
+	"		Properties70: {\n"
+	"			P: \"Lcl Translation\", \"Lcl Translation\", \"\", \"A\", 0.0, 0.0, 0.0\n"
+	"		}\n"
+	"	}\n"
+	"	AnimationCurveNode: 1005, \"AnimCurveNode::T\", \"\" {\n"
+	"		Properties70: {\n"
+	"			P: \"d|X\", \"Number\", \"\", \"A\", 0.0\n"
+	"		}\n"
+	"	}\n"
+	"	AnimationCurve: 1006, \"AnimCurve::\", \"\" {\n"
+	"		KeyVer: 4008\n"
+	"		KeyTime: *2 {\n"
+	"			a: 0,46186158000\n"
+	"		}\n"
+	"		KeyValueFloat: *2 {\n"
+	"			a: 0.0,1.0\n"
+	"		}\n"
+	"	}\n"
+	"}\n"
+	"Connections: {\n"
+	"	C: \"OO\", 1001, 1000\n"
+	"	C: \"OO\", 1003, 1002\n"
+	"	C: \"OO\", 1004, 0\n"
+	"	C: \"OO\", 1005, 1003\n"
+	"	C: \"OP\", 1005, 1004, \"Lcl Translation\"\n"
+	"	C: \"OP\", 1006, 1005, \"d|X\"\n"
+	"}\n";
+
+static IScene *loadText(const char *text)
+{
+	IScene *scene = load((const u8*)text, (int)strlen(text), LoadOptions());
+	if (nullptr == scene)
+		printf("failed to load: %s\n", getError());
+	return scene;
+}
+
+// ASCII object names keep their class prefix, "Model::name"
+static bool isNamed(const Object &object, const char *name)
+{
+	const char *separator = strstr(object.name, "::");
+	return 0 == strcmp(separator ? separator + 2 : object.name, name);
+}
+
+static Model *findModel(IScene &scene, const char *name)
+{
+	const Object *const *objects = scene.getAllObjects();
+	for (int i = 0, count = scene.getAllObjectCount(); i < count; ++i)
+	{
+		if (objects[i]->isNode() && isNamed(*objects[i], name))
+			return (Model*)objects[i];
+	}
+	return nullptr;
+}
+
+static int findTake(IScene &scene, const char *name)
+{
+	for (int i = 0, count = scene.getAnimationStackCount(); i < count; ++i)
+	{
+		if (isNamed(*scene.getAnimationStack(i), name))
+			return i;
+	}
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// tests
+
+// nodes attached through PropertyList::AttachAnimNodes are detached by the next take switch
+static void testTakeSwitchDetach()
+{
+	IScene *scene = loadText(TWO_TAKES_SCENE);
+	CHECK(nullptr != scene);
+	if (nullptr == scene)
+		return;
+
+	Model *model = findModel(*scene, "animated");
+	const int first = findTake(*scene, "Take 001");
+	const int second = findTake(*scene, "Take 002");
+	CHECK(nullptr != model);
+	CHECK(first >= 0 && second >= 0);
+	if (nullptr != model && first >= 0 && second >= 0)
+	{
+		CHECK(scene->PrepTakeConnections(second));
+		CHECK(model->Translation.IsAnimated());
+
+		CHECK(scene->PrepTakeConnections(first));
+		CHECK(!model->Translation.IsAnimated());
+
+		// the caller attaches the second take by hand, the switch to the first one has to undo it
+		const AnimationLayer *layer = scene->getAnimationStack(second)->getLayer(0);
+		CHECK(1 == model->mProperties.AttachAnimNodes(layer));
+		CHECK(model->Translation.IsAnimated());
+
+		CHECK(scene->PrepTakeConnections(first));
+		CHECK(!model->Translation.IsAnimated());
+	}
+
+	scene->destroy();
+}
+
+// job processor of the tests, runs the jobs in order on the calling thread
+static void serialJobProcessor(JobFunction fn, void *user_ptr, void *data, u32 size, u32 count)
+{
+	for (u32 i = 0; i < count; ++i)
+		fn((u8*)data + (size_t)i * size);
+}
+
+// the object jobs share the scratch buffers instead of growing new ones every job
+static void testParseContextReuse()
+{
+	LoadStats stats;
+	LoadOptions options;
+	options.stats = &stats;
+	options.job_processor = serialJobProcessor;
+
+	IScene *scene = load((const u8*)TWO_TAKES_SCENE, (int)strlen(TWO_TAKES_SCENE), options);
+	CHECK(nullptr != scene);
+	if (nullptr == scene)
+		return;
+	CHECK(scene->getAllObjectCount() > 1);
+	CHECK(1 == stats.parse_contexts);
+	scene->destroy();
+
+	// the built-in workers need at most one each
+	options.job_processor = nullptr;
+	options.thread_count = 4;
+	scene = load((const u8*)TWO_TAKES_SCENE, (int)strlen(TWO_TAKES_SCENE), options);
+	CHECK(nullptr != scene);
+	if (nullptr == scene)
+		return;
+	CHECK(stats.parse_contexts >= 1 && stats.parse_contexts <= 4);
+	scene->destroy();
+}
+
+struct ProgressJobs
+{
+	std::vector<u32>	reports;
+	u32					cancel_at = 0;	// report which stops the run, 0 - none
+	std::atomic<u32>	processed;
+};
+
+static void countJob(void *data)
+{
+	(*(std::atomic<u32>**)data)->fetch_add(1);
+}
+
+static bool recordProgress(u32 done, u32 count, void *user_ptr)
+{
+	ProgressJobs *jobs = (ProgressJobs*)user_ptr;
+	jobs->reports.push_back(done);
+	return jobs->reports.size() != jobs->cancel_at;
+}
+
+// one set of workers for the whole run, the reports grow up to the item count and can stop the run
+static void testJobProgress()
+{
+	const u32 count = 1000;
+	ProgressJobs jobs;
+	std::vector<std::atomic<u32>*> items(count, &jobs.processed);
+
+	jobs.processed = 0;
+	CHECK(RunJobsWithProgress(countJob, items.data(), (u32)sizeof(items[0]), count, 4, recordProgress, &jobs));
+	CHECK(count == jobs.processed);
+	CHECK(!jobs.reports.empty() && count == jobs.reports.back());
+	for (size_t i = 1; i < jobs.reports.size(); ++i)
+		CHECK(jobs.reports[i - 1] < jobs.reports[i]);
+
+	jobs.processed = 0;
+	jobs.reports.clear();
+	// on the calling thread alone, so the first report comes before the last item
+	jobs.cancel_at = 1;
+	CHECK(!RunJobsWithProgress(countJob, items.data(), (u32)sizeof(items[0]), count, 1, recordProgress, &jobs));
+	CHECK(jobs.processed < count);
+	CHECK(1 == jobs.reports.size());
+
+	jobs.processed = 0;
+	jobs.reports.clear();
+	jobs.cancel_at = 0;
+	CHECK(RunJobsWithProgress(countJob, items.data(), (u32)sizeof(items[0]), count, 4, recordProgress, &jobs, serialJobProcessor));
+	CHECK(count == jobs.processed);
+	CHECK(!jobs.reports.empty() && count == jobs.reports.back());
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main(int argc, char **argv)
+{
+	testTakeSwitchDetach();
+	testParseContextReuse();
+	testJobProgress();
+
+	if (gFailed > 0)
+		printf("%d checks failed\n", gFailed);
+	else
+		printf("all checks passed\n");
+	return gFailed;
+}